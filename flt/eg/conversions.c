@@ -0,0 +1,32 @@
+/*
+    Contents: "conversions" C source code (c) 2023
+  Repository: https://github.com/Russell-S-Harper/FLT
+     Contact: russell.s.harper@gmail.com
+*/
+
+/*
+  To Compile: gcc -o conversions conversions.c
+   Translate: php ../flt.php -d -i conversions.c -o conversions-flt.c
+  To Compile: gcc -o conversions-flt conversions-flt.c ../*.c -I ..
+      To Run: ./conversions > native.txt && ./conversions-flt > flt.txt && diff native.txt flt.txt
+       Notes: Checks how flt.php converts integers once where they don't change, n and k
+              should be hoisted out of the loop and reported with -d, while i and j are
+              converted each time. Both builds should output the same.
+*/
+
+#include <stdio.h>
+
+int main() {
+	float x = 0.5, y = 0.0;
+	int n = 7, i, j;
+	unsigned char k = 3;
+
+	for (i = 0; i < 4; ++i) {
+		for (j = 0; j < 3; ++j)
+			y = y + x * n - k + j;
+		x = x / n;
+		y = y * n + i;
+		printf("%.2f\n", y);
+	}
+	return 0;
+}
@@ -0,0 +1,39 @@
+/*
+    Contents: "labels" C source code (c) 2023
+  Repository: https://github.com/Russell-S-Harper/FLT
+     Contact: russell.s.harper@gmail.com
+*/
+
+/*
+  To Compile: gcc -o labels labels.c
+   Translate: php ../flt.php -b -i labels.c -o labels-flt.c
+  To Compile: gcc -o labels-flt labels-flt.c ../*.c -I ..
+      To Run: ./labels > native.txt && ./labels-flt > flt.txt && diff native.txt flt.txt
+       Notes: Checks how flt.php -b converts *printf calls after labels, case, and else,
+              and inside ?: expressions, only whole statements get buffers on the stack.
+              Both builds should compile and output the same.
+*/
+
+#include <stdio.h>
+
+int main() {
+	float x = 1.25;
+	int i, n;
+
+	for (i = 0; i < 4; ++i) {
+		switch (i) {
+			case 0: printf("case %.2f\n", x);
+				break;
+			case ':': break;
+			default: printf("default %.2f\n", x * i);
+		}
+		if (i == 3)
+			goto done;
+		n = (i & 1)? 0: printf("ternary %.2f\n", x + i);
+		printf("%d\n", n);
+		i & 1? printf("odd %.2f\n", x - i): printf("even %.2f\n", x - i);
+		if (i == 2) n = 0; else printf("else %.2f\n", x / (i + 3));
+	}
+done:	printf("done %.2f\n", x);
+	return 0;
+}
@@ -0,0 +1,72 @@
+/*
+    Contents: "roundtrip" C source code (c) 2023
+  Repository: https://github.com/Russell-S-Harper/FLT
+     Contact: russell.s.harper@gmail.com
+*/
+
+/*
+  To Compile: gcc -O2 -o roundtrip roundtrip.c ../*.c -I ..
+      To Run: ./roundtrip
+       Notes: Checks every one of the 2^32 FLT patterns reads back exactly from
+              flt_ftoa_shortest, and that the string one digit shorter doesn't,
+              takes a while! Any failures are outputted to stderr.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "flt.h"
+
+/* True if s with its last significant digit dropped, rounding down or up, still reads back as f */
+static bool shorter_reads_back(FLT f, const char *s) {
+	char t[40];
+	unsigned long n;
+	int count, exponent, i;
+	bool fraction;
+	for (n = 0, count = exponent = 0, fraction = false; *s && *s != 'e' && *s != 'E'; ++s) {
+		if (*s == '.')
+			fraction = true;
+		else if (*s >= '0' && *s <= '9') {
+			if (n || *s > '0') {
+				n = 10 * n + *s - '0';
+				++count;
+			}
+			if (fraction)
+				--exponent;
+		}
+	}
+	if (*s)
+		exponent += atoi(s + 1);
+	for (; n && !(n % 10); ++exponent, --count)
+		n /= 10;
+	for (i = 0; count > 1 && i < 2; ++i) {
+		snprintf(t, sizeof(t), "%lue%d", n / 10 + i, exponent + 1);
+		if (flt_atof(t) == flt_fabs(f))
+			return true;
+	}
+	return false;
+}
+
+int main() {
+	const char *s;
+	uint32_t f, failures;
+	FLT g;
+
+	f = failures = 0;
+	do {
+		s = flt_ftoa_shortest(f);
+		g = flt_atof(s);
+		/* NaN only has to read back as a NaN */
+		if ((flt_isnan(f)? !flt_isnan(g): g != f) || shorter_reads_back(f, s)) {
+			if (!failures++)
+				fputs("Pattern\tString\tRead back\n", stderr);
+			fprintf(stderr, "%08lX\t%s\t%08lX\n", (unsigned long)f, s, (unsigned long)g);
+		}
+		if (!(f & 0xFFFFFFF))
+			fprintf(stdout, "%08lX\n", (unsigned long)f);
+	} while (++f);
+	printf("Failures\t%lu\n", (unsigned long)failures);
+	return failures? 1: 0;
+}
@@ -36,7 +36,11 @@ static bool test_flt_add_into();	static bool test_flt_subtract_into();	static bo
 static bool test_flt_negated();		static bool test_flt_inverted();	static bool test_flt_atof();		static bool test_flt_ftoa();
 static bool test_flt_ltof();		static bool test_flt_ultof();		static bool test_flt_ftol();		static bool test_flt_ftoul();
 static bool test_flt_fmin();		static bool test_flt_fmax();		static bool test_flt_fsgn();		static bool test_flt_hypot();
-static bool test_flt_log2();		static bool test_flt_exp2();
+static bool test_flt_log2();		static bool test_flt_exp2();		static bool test_flt_remquo();		static bool test_flt_ftoa_shortest();
+static bool test_flt_ftoa_r();		static bool test_flt_fputf();		static bool test_flt_emit();		static bool test_flt_ftoa_fmt();
+static bool test_flt_ftoa_fmt_r();	static bool test_flt_strtof();		static bool test_flt_parse_array();
+static bool test_flt_ftoa_hex();		static bool test_flt_ext();		static bool test_flt_copysign();	static bool test_flt_inline();
+static bool test_flt_narrow();
 
 int main() {
 	TEST(ldexp);		TEST(frexp);		TEST(modf);		TEST(fmod);
@@ -53,7 +57,11 @@ int main() {
 	TEST(negated);		TEST(inverted);		TEST(atof);		TEST(ftoa);
 	TEST(ltof);		TEST(ultof);		TEST(ftol);		TEST(ftoul);
 	TEST(fmin);		TEST(fmax);		TEST(fsgn);		TEST(hypot);
-	TEST(log2);		TEST(exp2);
+	TEST(log2);		TEST(exp2);		TEST(remquo);		TEST(ftoa_shortest);
+	TEST(ftoa_r);		TEST(fputf);		TEST(emit);		TEST(ftoa_fmt);
+	TEST(ftoa_fmt_r);	TEST(strtof);		TEST(parse_array);
+	TEST(ftoa_hex);		TEST(ext);		TEST(copysign);		TEST(inline);
+	TEST(narrow);
 	return EXIT_SUCCESS;
 }
 
@@ -121,7 +129,7 @@ static bool test_flt_ldexp() {
 		}
 	}
 	printf("ldexp 0x%04X\n", crc);
-	return crc == 0x2504;
+	return crc == 0x76CD;
 }
 
 static bool test_flt_frexp() {
@@ -167,7 +175,7 @@ static bool test_flt_fmod() {
 		}
 	}
 	printf("fmod 0x%04X\n", crc);
-	return crc == 0x26AC;
+	return crc == 0x387B;
 }
 
 static bool test_flt_fabs() {
@@ -284,7 +292,7 @@ static bool test_flt_exp() {
 		printf("exp %ld %s\n", strlen(s), s);
 	}
 	printf("exp 0x%04X\n", crc);
-	return crc == 0x6056;
+	return crc == 0xEBCD;
 }
 
 static bool test_flt_exp10() {
@@ -762,7 +770,7 @@ static bool test_flt_atof() {
 		}
 	}
 	printf("atof 0x%04X\n", crc);
-	return crc == 0x10BA;
+	return crc == 0x567D;
 }
 
 static bool test_flt_ftoa() {
@@ -777,7 +785,7 @@ static bool test_flt_ftoa() {
 		}
 	}
 	printf("ftoa 0x%04X\n", crc);
-	return crc == 0xBE51;
+	return crc == 0x7300;
 }
 
 static bool test_flt_ltof() {
@@ -917,3 +925,364 @@ static bool test_flt_exp2() {
 	printf("exp2 0x%04X\n", crc);
 	return crc == 0x9124;
 }
+
+static bool test_flt_remquo() {
+	char s[100];
+	unsigned short crc;
+	int i, j, quotient;
+	FLT f;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(values)/sizeof(FLT); ++j) {
+			f = flt_remquo(values[i], values[j], &quotient);
+			snprintf(s, sizeof(s), "remquo(%s, %s) = %s, %d", flt_ftoa(values[i], "%e"), flt_ftoa(values[j], "%e"), flt_ftoa(f, "%e"), quotient);
+			crc = crc16(crc, s);
+			printf("remquo %ld %s\n", strlen(s), s);
+		}
+	}
+	printf("remquo 0x%04X\n", crc);
+	return crc == 0x71D5;
+}
+
+/* True if s with its last significant digit dropped, rounding down or up, still reads back as f */
+static bool shorter_reads_back(FLT f, const char *s) {
+	char t[40];
+	unsigned long n;
+	int count, exponent, i;
+	bool fraction;
+	for (n = 0, count = exponent = 0, fraction = false; *s && *s != 'e' && *s != 'E'; ++s) {
+		if (*s == '.')
+			fraction = true;
+		else if (*s >= '0' && *s <= '9') {
+			if (n || *s > '0') {
+				n = 10 * n + *s - '0';
+				++count;
+			}
+			if (fraction)
+				--exponent;
+		}
+	}
+	if (*s)
+		exponent += atoi(s + 1);
+	for (; n && !(n % 10); ++exponent, --count)
+		n /= 10;
+	for (i = 0; count > 1 && i < 2; ++i) {
+		snprintf(t, sizeof(t), "%lue%d", n / 10 + i, exponent + 1);
+		if (flt_atof(t) == flt_fabs(f))
+			return true;
+	}
+	return false;
+}
+
+static bool test_flt_ftoa_shortest() {
+	char s[100], *formats[] = {"%r", "%+R"};
+	/* Each has a string one digit shorter than the closest nine digits that still reads back */
+	FLT shortest[] = {0x3F80004B, 0x10E94EBE};
+	unsigned short crc;
+	int i, j, failures;
+	uint32_t f;
+	/* Spread over all the finite patterns, each has to read back and be the shortest */
+	for (f = 1, failures = 0; f < 0x7F800000; f += 0x10001)
+		if (flt_atof(flt_ftoa_shortest(f)) != f || shorter_reads_back(f, flt_ftoa_shortest(f))) {
+			fprintf(stderr, "ftoa_shortest %08lX %s\n", (unsigned long)f, flt_ftoa_shortest(f));
+			++failures;
+		}
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		snprintf(s, sizeof(s), "ftoa_shortest() = %s", flt_ftoa_shortest(values[i]));
+		crc = crc16(crc, s);
+		printf("ftoa_shortest %ld %s\n", strlen(s), s);
+		for (j = 0; j < sizeof(formats)/sizeof(char *); ++j) {
+			snprintf(s, sizeof(s), "ftoa(\"%s\") = %s", formats[j], flt_ftoa(values[i], formats[j]));
+			crc = crc16(crc, s);
+			printf("ftoa_shortest %ld %s\n", strlen(s), s);
+		}
+	}
+	for (i = 0; i < sizeof(shortest)/sizeof(FLT); ++i) {
+		snprintf(s, sizeof(s), "ftoa_shortest(0x%08lX) = %s", (unsigned long)shortest[i], flt_ftoa_shortest(shortest[i]));
+		crc = crc16(crc, s);
+		printf("ftoa_shortest %ld %s\n", strlen(s), s);
+	}
+	printf("ftoa_shortest 0x%04X\n", crc);
+	return crc == 0x090C && !failures;
+}
+
+static bool test_flt_ftoa_r() {
+	char s[100], b[60], *formats[] = {"%e", "%+.3E", "%f", "%.2f", "%g", "%r"};
+	unsigned short crc;
+	size_t lengths[] = {sizeof(b), 8, 1}, n;
+	int i, j, k;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(formats)/sizeof(char *); ++j) {
+			for (k = 0; k < sizeof(lengths)/sizeof(size_t); ++k) {
+				n = flt_ftoa_r(values[i], formats[j], b, lengths[k]);
+				snprintf(s, sizeof(s), "ftoa_r(\"%s\", %ld) = %ld %s", formats[j], lengths[k], n, b);
+				crc = crc16(crc, s);
+				printf("ftoa_r %ld %s\n", strlen(s), s);
+			}
+		}
+	}
+	printf("ftoa_r 0x%04X\n", crc);
+	return crc == 0x0DB7;
+}
+
+static bool test_flt_fputf() {
+	char s[100], b[60], *formats[] = {"%e", "%+.3E", "%f", "%.2f", "%g", "%r"};
+	unsigned short crc;
+	FILE *stream;
+	int i, j, n;
+	stream = tmpfile();
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(formats)/sizeof(char *); ++j) {
+			rewind(stream);
+			n = flt_fputf(stream, values[i], formats[j]);
+			rewind(stream);
+			b[fread(b, 1, sizeof(b) - 1, stream)] = '\0';
+			b[n < 0? 0: n] = '\0';
+			snprintf(s, sizeof(s), "fputf(\"%s\") = %d %s", formats[j], n, b);
+			crc = crc16(crc, s);
+			printf("fputf %ld %s\n", strlen(s), s);
+		}
+	}
+	fclose(stream);
+	printf("fputf 0x%04X\n", crc);
+	return crc == 0x634D;
+}
+
+static char emit_string[60];
+static int emit_index;
+
+static void emit_char(char c) {
+	if (emit_index < sizeof(emit_string) - 1)
+		emit_string[emit_index++] = c;
+}
+
+static bool test_flt_emit() {
+	char s[100], *formats[] = {"%e", "%+.3E", "%f", "%.2f", "%g", "%r"};
+	unsigned short crc;
+	size_t n;
+	int i, j;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(formats)/sizeof(char *); ++j) {
+			emit_index = 0;
+			n = flt_emit(values[i], formats[j], emit_char);
+			emit_string[emit_index] = '\0';
+			snprintf(s, sizeof(s), "emit(\"%s\") = %ld %s", formats[j], n, emit_string);
+			crc = crc16(crc, s);
+			printf("emit %ld %s\n", strlen(s), s);
+		}
+	}
+	printf("emit 0x%04X\n", crc);
+	return crc == 0x6D5B;
+}
+
+static bool test_flt_ftoa_fmt() {
+	char s[100];
+	unsigned short crc;
+	unsigned specs[] = {FLT_FMT_E | 6, FLT_FMT_E | FLT_FMT_UPPER | FLT_FMT_PLUS | 3, FLT_FMT_F | 6, FLT_FMT_F | 2,
+		FLT_FMT_G | FLT_FMT_UPPER | 4, FLT_FMT_R | FLT_FMT_PLUS};
+	int i, j;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(specs)/sizeof(unsigned); ++j) {
+			snprintf(s, sizeof(s), "ftoa_fmt(0x%04X) = %s", specs[j], flt_ftoa_fmt(values[i], specs[j]));
+			crc = crc16(crc, s);
+			printf("ftoa_fmt %ld %s\n", strlen(s), s);
+		}
+	}
+	printf("ftoa_fmt 0x%04X\n", crc);
+	/* The precisions taken from format strings, digits are read as a number and no more than nine */
+	for (i = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		if (strcmp(flt_ftoa(values[i], "%.05f"), flt_ftoa_fmt(values[i], FLT_FMT_F | 5))
+			|| strcmp(flt_ftoa(values[i], "%.12e"), flt_ftoa_fmt(values[i], FLT_FMT_E | 9))
+			|| strcmp(flt_ftoa(values[i], "%.f"), flt_ftoa_fmt(values[i], FLT_FMT_F))
+			|| strcmp(flt_ftoa(values[i], "%.*g"), flt_ftoa_fmt(values[i], FLT_FMT_G | 6)))
+			return false;
+	}
+	return crc == 0x830A;
+}
+
+static bool test_flt_ftoa_fmt_r() {
+	char s[100], b[60];
+	unsigned short crc;
+	unsigned specs[] = {FLT_FMT_E | 6, FLT_FMT_E | FLT_FMT_UPPER | FLT_FMT_PLUS | 3, FLT_FMT_F | 6, FLT_FMT_F | 2,
+		FLT_FMT_G | FLT_FMT_UPPER | 4, FLT_FMT_R | FLT_FMT_PLUS};
+	size_t lengths[] = {sizeof(b), 8}, n;
+	int i, j, k;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(specs)/sizeof(unsigned); ++j) {
+			for (k = 0; k < sizeof(lengths)/sizeof(size_t); ++k) {
+				n = flt_ftoa_fmt_r(values[i], specs[j], b, lengths[k]);
+				snprintf(s, sizeof(s), "ftoa_fmt_r(0x%04X, %ld) = %ld %s", specs[j], lengths[k], n, b);
+				crc = crc16(crc, s);
+				printf("ftoa_fmt_r %ld %s\n", strlen(s), s);
+			}
+		}
+	}
+	printf("ftoa_fmt_r 0x%04X\n", crc);
+	return crc == 0x5462;
+}
+
+static bool test_flt_strtof() {
+	char s[100], *end, *strings[] = {"1.5", "  -2e3xyz", "5.", ".5e", "1e+", "1e5+3", "inf,", "-nan ", "abc", "-", "", "12 34", "1e-2-3"};
+	unsigned short crc;
+	FLT f;
+	int i, j;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		/* Read back with something after */
+		snprintf(s, sizeof(s), "%s, ", flt_ftoa(values[i], "%r"));
+		f = flt_strtof(s, &end);
+		snprintf(s, sizeof(s), "strtof(\"%s\") = %s %ld", flt_ftoa(values[i], "%r"), flt_ftoa(f, "%e"), (long)(end - s));
+		crc = crc16(crc, s);
+		printf("strtof %ld %s\n", strlen(s), s);
+	}
+	for (j = 0; j < sizeof(strings)/sizeof(char *); ++j) {
+		f = flt_strtof(strings[j], &end);
+		snprintf(s, sizeof(s), "strtof(\"%s\") = %s %ld", strings[j], flt_ftoa(f, "%e"), (long)(end - strings[j]));
+		crc = crc16(crc, s);
+		printf("strtof %ld %s\n", strlen(s), s);
+	}
+	printf("strtof 0x%04X\n", crc);
+	return crc == 0x5DB8;
+}
+
+static bool test_flt_parse_array() {
+	char s[100], *strings[] = {" 1 2.5 \t -3e1 4 x 5", "1 2 3 4 5 6 7", "", "  ", " \t", "1-2", "1 x 2", "nan inf -inf", "1.5e3,\t-0"};
+	unsigned short crc;
+	FLT array[6];
+	float f[6];
+	int i, j, n;
+	for (i = 0, crc = 0; i < sizeof(strings)/sizeof(char *); ++i) {
+		n = flt_parse_array(strings[i], array, sizeof(array)/sizeof(FLT));
+		/* Same count as sscanf, including EOF for nothing but whitespace */
+		if (n != sscanf(strings[i], "%f %f %f %f %f %f", &f[0], &f[1], &f[2], &f[3], &f[4], &f[5]))
+			return false;
+		for (j = 0; j < sizeof(array)/sizeof(FLT); ++j) {
+			snprintf(s, sizeof(s), "parse_array(\"%s\") = %d %s", strings[i], n, flt_ftoa(array[j], "%e"));
+			crc = crc16(crc, s);
+			printf("parse_array %ld %s\n", strlen(s), s);
+		}
+	}
+	printf("parse_array 0x%04X\n", crc);
+	return crc == 0x31CC;
+}
+
+static bool test_flt_ftoa_hex() {
+	char s[100], *formats[] = {"%a", "%+A"}, *strings[] = {"0x1.8p+3", "-0X.8P-1", "0x1p-149", "0x1.fffffep127", "0x1.ffffffp127", "0x1p-150", "0x1.000001p0", "0x10", "0x"};
+	unsigned short crc;
+	int i, j;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(formats)/sizeof(char *); ++j) {
+			snprintf(s, sizeof(s), "ftoa(\"%s\") = %s", formats[j], flt_ftoa(values[i], formats[j]));
+			crc = crc16(crc, s);
+			printf("ftoa_hex %ld %s\n", strlen(s), s);
+		}
+	}
+	for (j = 0; j < sizeof(strings)/sizeof(char *); ++j) {
+		snprintf(s, sizeof(s), "atof(\"%s\") = %s", strings[j], flt_ftoa(flt_atof(strings[j]), "%a"));
+		crc = crc16(crc, s);
+		printf("ftoa_hex %ld %s\n", strlen(s), s);
+	}
+	printf("ftoa_hex 0x%04X\n", crc);
+	return crc == 0xE059;
+}
+
+static bool test_flt_ext() {
+	char s[100];
+	unsigned short crc;
+	FLT_EXT x, y;
+	FLT f, g;
+	int i, j;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(values)/sizeof(FLT); ++j) {
+			f = values[i];
+			g = values[j];
+			/* A single operation rounds the same as the packed version */
+			flt_ext_load(&x, f);
+			flt_ext_load(&y, g);
+			flt_ext_add(&x, &y);
+			if (flt_ext_store(&x) != flt_add(f, g))
+				return false;
+			flt_ext_load(&x, f);
+			flt_ext_subtract(&x, &y);
+			if (flt_ext_store(&x) != flt_subtract(f, g))
+				return false;
+			flt_ext_load(&x, f);
+			flt_ext_multiply(&x, &y);
+			if (flt_ext_store(&x) != flt_multiply(f, g))
+				return false;
+			flt_ext_load(&x, f);
+			flt_ext_divide(&x, &y);
+			if (flt_ext_store(&x) != flt_divide(f, g))
+				return false;
+			/* (f*g + f)/g - g, only rounding the result */
+			flt_ext_load(&x, f);
+			flt_ext_multiply_f(&x, g);
+			flt_ext_load(&y, f);
+			flt_ext_add(&x, &y);
+			flt_ext_divide_f(&x, g);
+			flt_ext_subtract_f(&x, g);
+			/* f + f/g */
+			flt_ext_load(&y, f);
+			flt_ext_divide_f(&y, g);
+			flt_ext_add_f(&y, f);
+			snprintf(s, sizeof(s), "ext(%s, %s) = %s %s", flt_ftoa(f, "%e"), flt_ftoa(g, "%e"),
+				flt_ftoa(flt_ext_store(&x), "%e"), flt_ftoa(flt_ext_store(&y), "%e"));
+			crc = crc16(crc, s);
+			printf("ext %ld %s\n", strlen(s), s);
+		}
+	}
+	printf("ext 0x%04X\n", crc);
+	return crc == 0x02FB;
+}
+
+static bool test_flt_copysign() {
+	char s[100];
+	unsigned short crc;
+	int i, j;
+	for (i = 0, crc = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		for (j = 0; j < sizeof(values)/sizeof(FLT); ++j) {
+			snprintf(s, sizeof(s), "copysign(%s, %s) = %s", flt_ftoa(values[i], "%e"), flt_ftoa(values[j], "%e"), flt_ftoa(flt_copysign(values[i], values[j]), "%e"));
+			crc = crc16(crc, s);
+			printf("copysign %ld %s\n", strlen(s), s);
+		}
+	}
+	printf("copysign 0x%04X\n", crc);
+	return crc == 0xA969;
+}
+
+static bool test_flt_inline() {
+	FLT f;
+	int i;
+	for (i = 0; i < sizeof(values)/sizeof(FLT); ++i) {
+		f = values[i];
+		/* Comparisons against zero agree with flt_compare */
+		if (FLT_LESS_THAN_0(f) != flt_compare(f, FLT_POS_0, E_LESS_THAN)
+			|| FLT_GREATER_THAN_0(f) != flt_compare(f, FLT_POS_0, E_GREATER_THAN)
+			|| FLT_ISZERO(f) != flt_compare(f, FLT_NEG_0, E_EQUAL_TO))
+			return false;
+		/* Negation flips only the sign, so applying it twice gives back the same bits */
+		if (FLT_NEGATED(FLT_NEGATED(f)) != f || FLT_FABS(f) != FLT_COPYSIGN(f, FLT_POS_0))
+			return false;
+	}
+	return true;
+}
+
+static bool test_flt_narrow() {
+	int32_t i, l;
+	uint32_t f, u;
+	/* The 16 and 8 bit forms agree with the 32 bit forms, saturating at their own limits */
+	for (i = INT16_MIN; i <= UINT16_MAX; ++i) {
+		if ((i <= INT16_MAX && flt_itof16(i) != flt_ltof(i)) || (i >= 0 && flt_uitof16(i) != flt_ultof(i))
+			|| (i >= 0 && i <= UCHAR_MAX && flt_uctof(i) != flt_ultof(i)))
+			return false;
+	}
+	f = 0;
+	do {
+		l = flt_ftol(f);
+		u = flt_ftoul(f);
+		if (flt_ftoi16(f) != (l < INT16_MIN? INT16_MIN: l > INT16_MAX? INT16_MAX: l)
+			|| flt_ftoui16(f) != (u > UINT16_MAX? UINT16_MAX: u) || flt_ftouc(f) != (u > UCHAR_MAX? UCHAR_MAX: u))
+			return false;
+		if (flt_itof(flt_ftoi(f)) != flt_ltof((int)flt_ftoi(f)) || flt_uitof(flt_ftoui(f)) != flt_ultof(flt_ftoui(f)))
+			return false;
+	} while ((f += 0x3FF1) > 0x3FF0);
+	return true;
+}
@@ -43,8 +43,7 @@ FLT flt_divide(const FLT f, const FLT g) {
 	flt_tmp t, u;
 	flt_to_tmp(&f, &t);
 	flt_to_tmp(&g, &u);
-	flt_tmp_invert(&u);
-	flt_tmp_multiply(&t, &u);
+	flt_tmp_divide(&t, &u);
 	tmp_to_flt(&t, &result);
 	return result;
 }
@@ -89,8 +88,7 @@ FLT flt_divide_into(FLT *pf, const FLT g) {
 		return FLT_NAN;
 	flt_to_tmp(pf, &t);
 	flt_to_tmp(&g, &u);
-	flt_tmp_invert(&u);
-	flt_tmp_multiply(&t, &u);
+	flt_tmp_divide(&t, &u);
 	tmp_to_flt(&t, pf);
 	return *pf;
 }
@@ -121,15 +119,7 @@ FLT flt_post_decrement(FLT *pf) {
 	return g;
 }
 
-FLT flt_negated(const FLT f) {
-	/* This seems wasteful given what little flt_tmp_negate does but we'll do it this way for consistency! */
-	FLT result;
-	flt_tmp t;
-	flt_to_tmp(&f, &t);
-	flt_tmp_negate(&t);
-	tmp_to_flt(&t, &result);
-	return result;
-}
+FLT flt_negated(const FLT f) { return FLT_NEGATED(f); }
 
 FLT flt_inverted(const FLT f) {
 	FLT result;
@@ -332,3 +322,37 @@ void flt_tmp_invert(flt_tmp *pt) {
 		}
 	}
 }
+
+/* Divides the mantissas directly, so an exact quotient stays exact in the extra bits, e.g. for flt_ext_divide */
+void flt_tmp_divide(flt_tmp *pt, const flt_tmp *pu) {
+	uint32_t remainder, quotient;
+	flt_tmp v;
+	int i;
+	if (pt->c == E_NORMAL && pu->c == E_NORMAL) {
+		pt->s ^= pu->s;
+		pt->e -= pu->e + 1;
+		/* Standard binary division, one more bit as the quotient could be less than 1.0 */
+		remainder = pt->m;
+		quotient = 0;
+		for (i = 0; i <= TMP_2_BITS; ++i) {
+			quotient <<= 1;
+			if (remainder >= pu->m) {
+				++quotient;
+				remainder -= pu->m;
+			}
+			remainder <<= 1;
+		}
+		/* The quotient is at least TMP_1, bring it below TMP_2 here so the sticky bit isn't shifted out */
+		if (quotient >= TMP_2) {
+			quotient = (quotient >> 1) | (quotient & 1);
+			++pt->e;
+		}
+		/* Sticky bit, so a quotient just above a tie doesn't round as the tie */
+		pt->m = quotient | (remainder != 0);
+	} else {
+		/* The special cases are the same as multiplying by the inverse */
+		flt_tmp_copy(&v, pu);
+		flt_tmp_invert(&v);
+		flt_tmp_multiply(pt, &v);
+	}
+}
@@ -21,15 +21,15 @@ E_CLASS flt_classify(const FLT f) {
 	}
 }
 
-bool flt_isinf(const FLT f) { return flt_classify(f) == E_INFINITE; }
+bool flt_isinf(const FLT f) { return FLT_ISINF(f); }
 
-bool flt_isnan(const FLT f) { return flt_classify(f) == E_NAN; }
+bool flt_isnan(const FLT f) { return FLT_ISNAN(f); }
 
 bool flt_isnormal(const FLT f) { return flt_classify(f) == E_NORMAL; }
 
 bool flt_issubnormal(const FLT f) { return flt_classify(f) == E_SUBNORMAL; }
 
-bool flt_iszero(const FLT f) { return flt_classify(f) == E_ZERO; }
+bool flt_iszero(const FLT f) { return FLT_ISZERO(f); }
 
 bool flt_isfinite(const FLT f) {
 	E_CLASS c = flt_classify(f);
@@ -37,11 +37,4 @@ bool flt_isfinite(const FLT f) {
 }
 
 /* Returns -1, 0, or +1 if f < 0, f = 0 (or NaN), or f > 0 respectively */
-int flt_fsgn(const FLT f) {
-	flt_tmp t;
-	flt_to_tmp(&f, &t);
-	if (t.c == E_ZERO || t.c == E_NAN)
-		return 0;
-	else
-		return t.s? -1: +1;
-}
+int flt_fsgn(const FLT f) { return FLT_FSGN(f); }
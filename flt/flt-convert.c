@@ -3,77 +3,261 @@
   Repository: https://github.com/Russell-S-Harper/FLT
      Contact: russell.s.harper@gmail.com
 */
-#include <stdlib.h>
+#include <limits.h>
 
 #include "flt-tmp.h"
 
+static uint32_t flt_round_to_integer(const FLT f, const int exponent);
+static FLT flt_pack_integer(const uint32_t sign, uint32_t a);
+static uint16_t flt_round_to_integer16(const uint16_t high, const uint16_t low, const int exponent);
+static FLT flt_pack_integer16(const uint16_t sign, uint16_t a);
+
 FLT flt_ltof(const int32_t a) {
-	FLT result;
-	flt_tmp t;
-	if (a) {
-		flt_tmp_initialize(&t, E_NORMAL, a < 0, labs(a), TMP_1_BITS);
-		flt_tmp_normalize(&t);
-	} else
-		flt_tmp_init_0(&t);
-	tmp_to_flt(&t, &result);
-	return result;
+	/* Negate as unsigned so that INT32_MIN is handled */
+	return a < 0? flt_pack_integer(FLT_S_MASK, -(uint32_t)a): flt_pack_integer(0, a);
 }
 
 FLT flt_ultof(const uint32_t a) {
-	FLT result;
-	flt_tmp t;
-	if (a) {
-		flt_tmp_initialize(&t, E_NORMAL, 0, a, TMP_1_BITS);
-		flt_tmp_normalize(&t);
-	} else
-		flt_tmp_init_0(&t);
-	tmp_to_flt(&t, &result);
-	return result;
+	return flt_pack_integer(0, a);
 }
 
 int32_t flt_ftol(const FLT f) {
-	/* Default handles a lot of cases! */
-	int32_t result = 0;
-	uint32_t mantissa;
-	flt_tmp t, u;
-	flt_to_tmp(&f, &t);
-	/* Add one half for rounding */
-	flt_tmp_initialize(&u, E_NORMAL, t.s, TMP_1, -1);
-	flt_tmp_add(&t, &u);
-	if (t.c == E_INFINITE || (t.c == E_NORMAL && t.e > TMP_1_BITS))
-		result = t.s? INT32_MIN: INT32_MAX;
-	else if (t.c == E_NORMAL && t.e >= 0) {
-		result = t.m >> (TMP_1_BITS - t.e);
-		/* Banker's "un-rounding" */
-		mantissa = t.m << (t.e + 2);
-		if (!mantissa && (result & 1))
-			--result;
-		if (t.s)
-			result = -result;
+	uint32_t result;
+	int exponent = flt_exponent(f);
+	/* NaN is zero, infinity and anything too large saturates */
+	if (exponent > TMP_1_BITS)
+		return (exponent > FLT_E_BIAS && (f & FLT_M_MASK))? 0: (f & FLT_S_MASK)? INT32_MIN: INT32_MAX;
+	result = flt_round_to_integer(f, exponent);
+	return (f & FLT_S_MASK)? -(int32_t)result: (int32_t)result;
+}
+
+uint32_t flt_ftoul(const FLT f) {
+	int exponent = flt_exponent(f);
+	/* NaN is zero, infinity and anything too large saturates */
+	if (exponent > TMP_2_BITS)
+		return (exponent > FLT_E_BIAS && (f & FLT_M_MASK))? 0: (exponent > FLT_E_BIAS || !(f & FLT_S_MASK))? UINT32_MAX: 0;
+	/* Negative numbers are zero */
+	return (f & FLT_S_MASK)? 0: flt_round_to_integer(f, exponent);
+}
+
+/* The 16 and 8 bit forms work on the high and low words of FLT so that a 16 bit int is enough, e.g. for cc65 */
+
+FLT flt_itof16(const int16_t a) {
+	/* Negate as unsigned so that INT16_MIN is handled */
+	return a < 0? flt_pack_integer16(0x8000, -(uint16_t)a): flt_pack_integer16(0, a);
+}
+
+FLT flt_uitof16(const uint16_t a) {
+	return flt_pack_integer16(0, a);
+}
+
+FLT flt_uctof(const unsigned char a) {
+	unsigned char b = a;
+	int exponent;
+	if (!b)
+		return FLT_POS_0;
+	/* Normalize so the top bit is set, the implicit bit is dropped by the mask */
+	exponent = FLT_E_BIAS + 7;
+	if (!(b & 0xF0)) {
+		b <<= 4;
+		exponent -= 4;
+	}
+	if (!(b & 0xC0)) {
+		b <<= 2;
+		exponent -= 2;
+	}
+	if (!(b & 0x80)) {
+		b <<= 1;
+		exponent -= 1;
 	}
+	return (uint32_t)((exponent << 7) | (b & 0x7F)) << 16;
+}
+
+int16_t flt_ftoi16(const FLT f) {
+	uint16_t high = f >> 16, result;
+	int exponent = ((high >> 7) & 0xFF) - FLT_E_BIAS;
+	/* NaN is zero, infinity and anything too large saturates */
+	if (exponent > 15)
+		return (exponent > FLT_E_BIAS && (f & FLT_M_MASK))? 0: (high & 0x8000)? INT16_MIN: INT16_MAX;
+	result = flt_round_to_integer16(high, f, exponent);
+	if (high & 0x8000)
+		return (result > 0x8000)? INT16_MIN: -(int16_t)(result - 1) - 1;
+	return (result > 0x7FFF)? INT16_MAX: (int16_t)result;
+}
+
+uint16_t flt_ftoui16(const FLT f) {
+	uint16_t high = f >> 16;
+	int exponent = ((high >> 7) & 0xFF) - FLT_E_BIAS;
+	/* NaN is zero, infinity and anything too large saturates */
+	if (exponent > 15)
+		return (exponent > FLT_E_BIAS && (f & FLT_M_MASK))? 0: (exponent > FLT_E_BIAS || !(high & 0x8000))? UINT16_MAX: 0;
+	/* Negative numbers are zero */
+	return (high & 0x8000)? 0: flt_round_to_integer16(high, f, exponent);
+}
+
+unsigned char flt_ftouc(const FLT f) {
+	uint16_t high = f >> 16, result;
+	int exponent = ((high >> 7) & 0xFF) - FLT_E_BIAS;
+	/* NaN is zero, infinity and anything too large saturates */
+	if (exponent > 7)
+		return (exponent > FLT_E_BIAS && (f & FLT_M_MASK))? 0: (exponent > FLT_E_BIAS || !(high & 0x8000))? UCHAR_MAX: 0;
+	/* Negative numbers are zero */
+	if (high & 0x8000)
+		return 0;
+	result = flt_round_to_integer16(high, f, exponent);
+	return (result > UCHAR_MAX)? UCHAR_MAX: (unsigned char)result;
+}
+
+/* Plain int and unsigned use the 16 bit forms where int is 16 bits */
+
+FLT flt_itof(const int a) {
+#if	INT_MAX == 0x7FFF
+	return flt_itof16(a);
+#else
+	return flt_ltof(a);
+#endif
+}
+
+FLT flt_uitof(const unsigned a) {
+#if	INT_MAX == 0x7FFF
+	return flt_uitof16(a);
+#else
+	return flt_ultof(a);
+#endif
+}
+
+int flt_ftoi(const FLT f) {
+#if	INT_MAX == 0x7FFF
+	return flt_ftoi16(f);
+#else
+	return flt_ftol(f);
+#endif
+}
+
+unsigned flt_ftoui(const FLT f) {
+#if	INT_MAX == 0x7FFF
+	return flt_ftoui16(f);
+#else
+	return flt_ftoul(f);
+#endif
+}
+
+/* Returns the magnitude of f rounded to an integer using Banker's rounding, expects exponent <= 31 */
+static uint32_t flt_round_to_integer(const FLT f, const int exponent) {
+	uint32_t mantissa, remainder, half, result;
+	int shift;
+	/* Less than one half, including zero and subnormals */
+	if (exponent < -1)
+		return 0;
+	mantissa = (f & FLT_M_MASK) | (FLT_M_MASK + 1);
+	/* No fraction bits, just shift up */
+	if (exponent >= FLT_M_BITS)
+		return mantissa << (exponent - FLT_M_BITS);
+	/* Banker's rounding using the bits shifted out */
+	shift = FLT_M_BITS - exponent;
+	result = mantissa >> shift;
+	remainder = mantissa & ((1UL << shift) - 1);
+	half = 1UL << (shift - 1);
+	if (remainder > half || (remainder == half && (result & 1)))
+		++result;
 	return result;
 }
 
-uint32_t flt_ftoul(const FLT f) {
-	/* Default handles a lot of cases! */
-	uint32_t result = 0, mantissa;
-	flt_tmp t, u;
-	flt_to_tmp(&f, &t);
-	/* Add one half for rounding */
-	flt_tmp_initialize(&u, E_NORMAL, t.s, TMP_1, -1);
-	flt_tmp_add(&t, &u);
-	if (t.c == E_INFINITE || (t.c == E_NORMAL && !t.s && t.e > TMP_2_BITS))
-		result = UINT32_MAX;
-	else if (t.c == E_NORMAL && !t.s && t.e >= 0) {
-		result = (t.m << 1) >> (TMP_2_BITS - t.e);
-		/* Banker's "un-rounding" */
-		mantissa = t.m << (t.e + 2);
-		if (!mantissa && (result & 1))
-			--result;
+/* Same as flt_round_to_integer using the top 16 bits of the mantissa, the rest only breaks ties, expects exponent <= 15 */
+static uint16_t flt_round_to_integer16(const uint16_t high, const uint16_t low, const int exponent) {
+	uint16_t mantissa, remainder, half, result;
+	bool sticky;
+	int shift;
+	/* Less than one half, including zero and subnormals */
+	if (exponent < -1)
+		return 0;
+	mantissa = (high << 8) | 0x8000 | (low >> 8);
+	sticky = (low & 0xFF) != 0;
+	/* Between one half and one, only exactly one half rounds to zero */
+	if (exponent == -1)
+		return (mantissa > 0x8000 || sticky)? 1: 0;
+	/* No fraction bits left in the top 16 bits, round on the low byte */
+	if (exponent == 15) {
+		result = mantissa;
+		remainder = low & 0xFF;
+		half = 0x80;
+		sticky = false;
+	} else {
+		shift = 15 - exponent;
+		result = mantissa >> shift;
+		remainder = mantissa & ((1U << shift) - 1);
+		half = 1U << (shift - 1);
 	}
+	/* Saturates rather than wrapping to zero */
+	if ((remainder > half || (remainder == half && (sticky || (result & 1)))) && result != UINT16_MAX)
+		++result;
 	return result;
 }
 
+/* Same as flt_pack_integer for 16 bits, which fit in the mantissa so no rounding is needed */
+static FLT flt_pack_integer16(const uint16_t sign, uint16_t a) {
+	int exponent;
+	if (!a)
+		return (uint32_t)sign << 16;
+	/* Normalize so the top bit is set, the implicit bit is dropped by the mask */
+	exponent = FLT_E_BIAS + 15;
+	if (!(a & 0xFF00)) {
+		a <<= 8;
+		exponent -= 8;
+	}
+	if (!(a & 0xF000)) {
+		a <<= 4;
+		exponent -= 4;
+	}
+	if (!(a & 0xC000)) {
+		a <<= 2;
+		exponent -= 2;
+	}
+	if (!(a & 0x8000)) {
+		a <<= 1;
+		exponent -= 1;
+	}
+	/* High word has the sign, the exponent, and the top seven fraction bits, the low word has the rest */
+	return ((uint32_t)(sign | (exponent << 7) | ((a >> 8) & 0x7F)) << 16) | (uint16_t)(a << 8);
+}
+
+/* Convenience function to convert a magnitude and sign to FLT */
+static FLT flt_pack_integer(const uint32_t sign, uint32_t a) {
+	uint32_t remainder;
+	int exponent;
+	if (!a)
+		return sign;
+	/* Normalize so the top bit is set, coarse steps first */
+	exponent = 31;
+	if (!(a & 0xFFFF0000UL)) {
+		a <<= 16;
+		exponent -= 16;
+	}
+	if (!(a & 0xFF000000UL)) {
+		a <<= 8;
+		exponent -= 8;
+	}
+	if (!(a & 0xF0000000UL)) {
+		a <<= 4;
+		exponent -= 4;
+	}
+	if (!(a & 0xC0000000UL)) {
+		a <<= 2;
+		exponent -= 2;
+	}
+	if (!(a & 0x80000000UL)) {
+		a <<= 1;
+		exponent -= 1;
+	}
+	/* Keep 24 bits, Banker's rounding on the 8 bits shifted out */
+	remainder = a & 0xFF;
+	a >>= 8;
+	if (remainder > 0x80 || (remainder == 0x80 && (a & 1)))
+		++a;
+	/* The implicit bit adds one to the exponent, and any carry from rounding rolls into the exponent */
+	return sign + ((uint32_t)(exponent + FLT_E_BIAS - 1) << FLT_M_BITS) + a;
+}
+
 void flt_to_tmp(const FLT *pf, flt_tmp *pt) {
 	uint32_t temporary, mantissa;
 	int sign, exponent;
@@ -123,8 +307,8 @@ void tmp_to_flt(const flt_tmp *pt, FLT *pf) {
 		} else if (pt->e > 127)
 			/* Infinity */
 			*pf = pt->s? FLT_NEG_INF: FLT_POS_INF;
-		else if (pt->e < -157)
-			/* Zero */
+		else if (pt->e < -150)
+			/* Zero, below half the smallest subnormal, and the shift below would be past 31 bits */
 			*pf = pt->s? FLT_NEG_0: FLT_POS_0;
 		else {
 			/* Subnormal - round up last 8 bits */
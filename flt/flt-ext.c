@@ -0,0 +1,62 @@
+/*
+    Contents: "ext" C source code (c) 2023
+  Repository: https://github.com/Russell-S-Harper/FLT
+     Contact: russell.s.harper@gmail.com
+*/
+#include "flt-tmp.h"
+
+/* Expression kernel: operands are unpacked once, intermediate results stay in flt_tmp, and only the result is packed */
+
+void flt_ext_load(FLT_EXT *px, const FLT f) {
+	flt_to_tmp(&f, px);
+}
+
+FLT flt_ext_store(const FLT_EXT *px) {
+	FLT result;
+	tmp_to_flt(px, &result);
+	return result;
+}
+
+void flt_ext_add(FLT_EXT *px, const FLT_EXT *py) {
+	flt_tmp_add(px, py);
+}
+
+void flt_ext_subtract(FLT_EXT *px, const FLT_EXT *py) {
+	flt_tmp u;
+	flt_tmp_copy(&u, py);
+	flt_tmp_negate(&u);
+	flt_tmp_add(px, &u);
+}
+
+void flt_ext_multiply(FLT_EXT *px, const FLT_EXT *py) {
+	flt_tmp_multiply(px, py);
+}
+
+void flt_ext_divide(FLT_EXT *px, const FLT_EXT *py) {
+	flt_tmp_divide(px, py);
+}
+
+void flt_ext_add_f(FLT_EXT *px, const FLT g) {
+	flt_tmp u;
+	flt_to_tmp(&g, &u);
+	flt_tmp_add(px, &u);
+}
+
+void flt_ext_subtract_f(FLT_EXT *px, const FLT g) {
+	flt_tmp u;
+	flt_to_tmp(&g, &u);
+	flt_tmp_negate(&u);
+	flt_tmp_add(px, &u);
+}
+
+void flt_ext_multiply_f(FLT_EXT *px, const FLT g) {
+	flt_tmp u;
+	flt_to_tmp(&g, &u);
+	flt_tmp_multiply(px, &u);
+}
+
+void flt_ext_divide_f(FLT_EXT *px, const FLT g) {
+	flt_tmp u;
+	flt_to_tmp(&g, &u);
+	flt_tmp_divide(px, &u);
+}
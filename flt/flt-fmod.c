@@ -3,40 +3,94 @@
   Repository: https://github.com/Russell-S-Harper/FLT
      Contact: russell.s.harper@gmail.com
 */
+#include <limits.h>
+#include <stdlib.h>
+
 #include "flt-tmp.h"
 
+static FLT flt_remainder(const FLT f, const FLT g, int *quotient, const bool nearest);
+static int flt_unpack(const FLT f, uint32_t *mantissa);
+
 FLT flt_fmod(const FLT f, const FLT g) {
-	FLT result;
-	flt_tmp t, u, v;
-	int sign;
-	flt_to_tmp(&f, &t);
-	flt_to_tmp(&g, &u);
-	/* The sign of t "decides" the sign of the result */
-	sign = t.s;
-	t.s = u.s = 0;
-	if (t.c == E_NORMAL && u.c == E_NORMAL &&
-		flt_tmp_compare(&t, &u, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_copy(&v, &u);
-		flt_tmp_invert(&u);
-		flt_tmp_multiply(&t, &u);
-		flt_tmp_modf(&t, &u);
-		flt_tmp_multiply(&t, &v);
-		t.s = sign;
-		tmp_to_flt(&t, &result);
+	int quotient;
+	return flt_remainder(f, g, &quotient, false);
+}
+
+FLT flt_remquo(const FLT f, const FLT g, int *quotient) {
+	/* Destination can't be NULL */
+	if (quotient == NULL)
+		exit(EXIT_FAILURE);
+	return flt_remainder(f, g, quotient, true);
+}
+
+/* Exact remainder using shift-and-subtract on the integer mantissas. The quotient is truncated
+   for fmod or rounded to nearest (ties to even) for remquo, and its low bits are returned. */
+static FLT flt_remainder(const FLT f, const FLT g, int *quotient, const bool nearest) {
+	uint32_t sign, mx, my, q;
+	int ex, ey;
+	*quotient = 0;
+	/* Infinity or NaN in f, NaN or zero in g, all result in NaN */
+	if (flt_exponent(f) > FLT_E_BIAS || flt_isnan(g) || !(g & ~FLT_S_MASK))
+		return FLT_NAN;
+	/* Zero in f or infinity in g leave f unchanged */
+	if (!(f & ~FLT_S_MASK) || flt_isinf(g))
+		return f;
+	sign = f & FLT_S_MASK;
+	ex = flt_unpack(f, &mx);
+	ey = flt_unpack(g, &my);
+	q = 0;
+	if (ex < ey) {
+		/* |f| < |g|/2 is unchanged, and so is |f| < |g| if truncating */
+		if (!nearest || ex < ey - 1)
+			return f;
+		/* Otherwise compare at the scale of f */
+		my <<= 1;
+		ey = ex;
 	} else {
-		/* Default to NaN */
-		result = FLT_NAN;
-		switch (t.c) {
-			case E_ZERO:
-			case E_NORMAL:
-				switch (u.c) {
-					case E_INFINITE:
-					case E_NORMAL:
-						result = f;
-						break;
-				}
-				break;
+		/* Long division, one quotient bit per exponent step */
+		for (; ex > ey; --ex) {
+			if (mx >= my) {
+				mx -= my;
+				++q;
+			}
+			mx <<= 1;
+			q <<= 1;
+		}
+		if (mx >= my) {
+			mx -= my;
+			++q;
 		}
 	}
-	return result;
+	/* Round the quotient to nearest, ties to even, which flips the sign of the remainder */
+	if (nearest && ((mx << 1) > my || ((mx << 1) == my && (q & 1)))) {
+		mx = my - mx;
+		++q;
+		sign ^= FLT_S_MASK;
+	}
+	*quotient = (int)(q & INT_MAX);
+	if ((f ^ g) & FLT_S_MASK)
+		*quotient = -*quotient;
+	/* Exact zero */
+	if (!mx)
+		return f & FLT_S_MASK;
+	/* Normalize, the remainder is smaller than g so only shifting up is needed */
+	for (; !(mx & (FLT_M_MASK + 1)); --ey)
+		mx <<= 1;
+	/* Normal, the implicit bit adds one to the exponent */
+	if (ey >= 1 - FLT_E_BIAS)
+		return sign + ((uint32_t)(ey + FLT_E_BIAS - 1) << FLT_M_BITS) + mx;
+	/* Subnormal, exact since the remainder is a multiple of the smaller ULP of f and g */
+	return sign | (mx >> (1 - FLT_E_BIAS - ey));
+}
+
+/* Convenience function to get the 24 bit mantissa with the implicit bit, and the unbiased exponent, of a finite non-zero f */
+static int flt_unpack(const FLT f, uint32_t *mantissa) {
+	int exponent = flt_exponent(f);
+	*mantissa = f & FLT_M_MASK;
+	if (exponent >= 1 - FLT_E_BIAS)
+		*mantissa |= FLT_M_MASK + 1;
+	else
+		for (exponent = 1 - FLT_E_BIAS; !(*mantissa & (FLT_M_MASK + 1)); --exponent)
+			*mantissa <<= 1;
+	return exponent;
 }
@@ -8,14 +8,30 @@
 #include "flt-tmp.h"
 
 FLT flt_frexp(const FLT f, int *exponent) {
-	FLT result;
-	flt_tmp t;
+	uint32_t mantissa;
+	int working;
 	/* Destination can't be NULL */
 	if (exponent == NULL)
 		exit(EXIT_FAILURE);
-	flt_to_tmp(&f, &t);
-	*exponent = t.e;
-	t.e = 0;
-	tmp_to_flt(&t, &result);
-	return result;
+	working = flt_exponent(f);
+	mantissa = f & FLT_M_MASK;
+	/* Infinity and NaN have no exponent */
+	if (working > FLT_E_BIAS) {
+		*exponent = 0;
+		return mantissa? FLT_NAN: f;
+	}
+	if (working < 1 - FLT_E_BIAS) {
+		/* Zero has no exponent */
+		if (!mantissa) {
+			*exponent = 0;
+			return f;
+		}
+		/* Subnormal, shift up to normalize */
+		for (working = 1 - FLT_E_BIAS; !(mantissa & (FLT_M_MASK + 1)); --working)
+			mantissa <<= 1;
+		mantissa &= FLT_M_MASK;
+	}
+	/* Replace the exponent with zero, i.e. 1 <= |result| < 2 */
+	*exponent = working;
+	return (f & FLT_S_MASK) | ((uint32_t)FLT_E_BIAS << FLT_M_BITS) | mantissa;
 }
@@ -4,6 +4,7 @@
      Contact: russell.s.harper@gmail.com
 */
 #include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,8 +13,18 @@
 /* Modes when parsing strings */
 typedef enum { E_BEGIN = 1, E_INTEGER, E_FRACTION, E_EXPONENT } E_MODE;
 
-/* Rounding to use when converting to strings */
-typedef enum { E_BEFORE = 1, E_AFTER } E_ROUNDING;
+/* Layout styles, "G" resolves to one of "E" or "F" */
+typedef enum { E_STYLE_E = 1, E_STYLE_F, E_STYLE_R, E_STYLE_A } E_STYLE;
+
+/* Destination of formatted characters, one of a string of length characters, a stream, or a callback */
+typedef struct {
+	char *string;
+	size_t length;
+	FILE *stream;
+	void (*put_char)(char);
+	size_t count;
+	bool upper, failed;
+} flt_sink;
 
 /* Maximum "E" format can be 17 characters including the null terminator: +#.#########E+##_ */
 #define	FMT_E_MAX_LEN 17
@@ -23,36 +34,130 @@ typedef enum { E_BEFORE = 1, E_AFTER } E_ROUNDING;
 #define	FMT_F_MAX_LEN 51
 #define	FMT_F_BFR_LEN (5 * FMT_F_MAX_LEN)	/* Can provide up to 5 "F" calls in one printf statement (5 * 51 = 255) */
 
+/* Maximum "A" format fits in the "E" format buffers: -0x1.######p-###_ */
+
+/* Maximum "R" format is never longer than "E" format with 9 digits */
+#define	FMT_R_MAX_LEN 17
+#define	FMT_R_BFR_LEN (15 * FMT_R_MAX_LEN)	/* Can provide up to 15 "R" calls in one printf statement (15 * 17 = 255) */
+
+/* Exact unsigned integers in 16 bit words, least significant first, enough for 2^26 * 5^45 in "R" and 2^25 * 5^54 in atof.
+   Only the first n words are used, the rest are kept zero. */
+#define	BIG_WORDS 12
+typedef struct {
+	int n;
+	uint16_t w[BIG_WORDS];
+} flt_big;
+
+/* Up to 9 decimal digits fit in the flt_tmp mantissa without loss */
+#define	ATOF_MAX_DIGITS 9
+#define	ATOF_MAX_EXPONENT 1000	/* Stop accumulating exponents past this to avoid overflow */
+
+/* Range of the power of ten table, enough to take any 9 digit integer to FLT zero or infinity and back */
+#define	POW10_MIN (-54)
+#define	POW10_MAX (54)
+#define	K10N(n) (&k10n[(n) - (POW10_MIN)])
+
+/* Up to 9 significant digits are generated, 10^9 still fits in 32 bits */
+#define	FTOA_MAX_DIGITS 9
+
 /* Used in *scanf */
 int g_flt_last_scanf_result;
+FLT g_flt_scanf_values[FLT_SCANF_VALUES];
+
+static FLT flt_hex_strtof(const char *string, int i, const int sign, char **end);
+static FLT flt_nearest(FLT f, const uint32_t n, const int exponent);
+static int flt_midpoint_compare(const uint32_t n, const int exponent, const FLT f);
+static unsigned flt_spec(const char *format);
+static E_STYLE flt_tmp_style(const flt_tmp *pt, const unsigned spec, int *base_10_exponent);
+static void flt_tmp_emit(const FLT f, const flt_tmp *pt, const unsigned spec, const E_STYLE style, const int base_10_exponent, flt_sink *ps);
+static void flt_tmp_e_emit(const flt_tmp *pt, const unsigned spec, int base_10_exponent, flt_sink *ps);
+static void flt_tmp_f_emit(const flt_tmp *pt, const unsigned spec, const int base_10_exponent, flt_sink *ps);
+static void flt_a_emit(const FLT f, const unsigned spec, flt_sink *ps);
+static void flt_r_emit(const FLT f, const flt_tmp *pt, const unsigned spec, const int base_10_exponent, flt_sink *ps);
+static int flt_r_digits(const FLT f, int base_10_exponent, char *digits, int *pexponent);
+static int flt_tmp_base_10_exponent(const flt_tmp *pt);
+static bool flt_tmp_less_than(const flt_tmp *pt, const flt_tmp *pu);
+static uint32_t flt_tmp_scale_to_integer(const flt_tmp *pt, const int scale);
+static int uint_to_digits(char *string, uint32_t n, const int width);
+static int spec_precision(const unsigned spec);
+static void flt_sink_initialize(flt_sink *ps, const unsigned spec);
+static void flt_sink_put(flt_sink *ps, char c);
+static void flt_sink_put_string(flt_sink *ps, const char *string);
+static void flt_sink_put_sign(flt_sink *ps, const flt_tmp *pt, const unsigned spec);
+static void flt_sink_put_fraction(flt_sink *ps, const char *digits, const int count, int precision, const unsigned spec);
+static void flt_big_set(flt_big *pb, const uint32_t n);
+static void flt_big_multiply(flt_big *pb, const uint16_t n);
+static void flt_big_scale(flt_big *pb, int base_5_exponent, int base_2_exponent);
+static void flt_big_add(flt_big *pb, const flt_big *pc);
+static void flt_big_subtract(flt_big *pb, const flt_big *pc);
+static int flt_big_compare(const flt_big *pb, const flt_big *pc);
 
-static void flt_tmp_prepare_constants();
-static const char *flt_tmp_e_format(flt_tmp *pt, const char *format);
-static const char *flt_tmp_f_format(flt_tmp *pt, const char *format);
-static const char *flt_tmp_g_format(flt_tmp *pt, const char *format);
-static int flt_tmp_normalize_to_base_10(flt_tmp *pt, int precision, const E_ROUNDING rounding);
-static char flt_tmp_get_next_digit(flt_tmp *pt);
-static int printf_precision(const char *format);
-static char *printf_post_process(char *string, const char *format, const int precision);
+/* 10^n for POW10_MIN <= n <= POW10_MAX, mantissas correctly rounded to the flt_tmp precision */
+static const flt_tmp k10n[] = {
+	{E_NORMAL, 0, -180, 0x6214682D}, {E_NORMAL, 0, -177, 0x7A998239}, {E_NORMAL, 0, -173, 0x4C9FF163}, {E_NORMAL, 0, -170, 0x5FC7EDBC},
+	{E_NORMAL, 0, -167, 0x77B9E92B}, {E_NORMAL, 0, -163, 0x4AD431BB}, {E_NORMAL, 0, -160, 0x5D893E2A}, {E_NORMAL, 0, -157, 0x74EB8DB4},
+	{E_NORMAL, 0, -153, 0x49133891}, {E_NORMAL, 0, -150, 0x5B5806B5}, {E_NORMAL, 0, -147, 0x722E0862}, {E_NORMAL, 0, -143, 0x475CC53D},
+	{E_NORMAL, 0, -140, 0x5933F68D}, {E_NORMAL, 0, -137, 0x6F80F430}, {E_NORMAL, 0, -133, 0x45B0989E}, {E_NORMAL, 0, -130, 0x571CBEC5},
+	{E_NORMAL, 0, -127, 0x6CE3EE77}, {E_NORMAL, 0, -123, 0x440E750A}, {E_NORMAL, 0, -120, 0x5512124D}, {E_NORMAL, 0, -117, 0x6A5696E0},
+	{E_NORMAL, 0, -113, 0x42761E4C}, {E_NORMAL, 0, -110, 0x5313A5DF}, {E_NORMAL, 0, -107, 0x67D88F57}, {E_NORMAL, 0, -103, 0x40E75996},
+	{E_NORMAL, 0, -100, 0x51212FFC}, {E_NORMAL, 0, -97, 0x65697BFB}, {E_NORMAL, 0, -94, 0x7EC3DAF9}, {E_NORMAL, 0, -90, 0x4F3A68DC},
+	{E_NORMAL, 0, -87, 0x63090313}, {E_NORMAL, 0, -84, 0x7BCB43D7}, {E_NORMAL, 0, -80, 0x4D5F0A67}, {E_NORMAL, 0, -77, 0x60B6CD00},
+	{E_NORMAL, 0, -74, 0x78E48040}, {E_NORMAL, 0, -70, 0x4B8ED028}, {E_NORMAL, 0, -67, 0x5E728432}, {E_NORMAL, 0, -64, 0x760F253F},
+	{E_NORMAL, 0, -60, 0x49C97747}, {E_NORMAL, 0, -57, 0x5C3BD519}, {E_NORMAL, 0, -54, 0x734ACA5F}, {E_NORMAL, 0, -50, 0x480EBE7C},
+	{E_NORMAL, 0, -47, 0x5A126E1B}, {E_NORMAL, 0, -44, 0x709709A1}, {E_NORMAL, 0, -40, 0x465E6605}, {E_NORMAL, 0, -37, 0x57F5FF86},
+	{E_NORMAL, 0, -34, 0x6DF37F67}, {E_NORMAL, 0, -30, 0x44B82FA1}, {E_NORMAL, 0, -27, 0x55E63B89}, {E_NORMAL, 0, -24, 0x6B5FCA6B},
+	{E_NORMAL, 0, -20, 0x431BDE83}, {E_NORMAL, 0, -17, 0x53E2D624}, {E_NORMAL, 0, -14, 0x68DB8BAC}, {E_NORMAL, 0, -10, 0x4189374C},
+	{E_NORMAL, 0, -7, 0x51EB851F}, {E_NORMAL, 0, -4, 0x66666666}, {E_NORMAL, 0, 0, 0x40000000}, {E_NORMAL, 0, 3, 0x50000000},
+	{E_NORMAL, 0, 6, 0x64000000}, {E_NORMAL, 0, 9, 0x7D000000}, {E_NORMAL, 0, 13, 0x4E200000}, {E_NORMAL, 0, 16, 0x61A80000},
+	{E_NORMAL, 0, 19, 0x7A120000}, {E_NORMAL, 0, 23, 0x4C4B4000}, {E_NORMAL, 0, 26, 0x5F5E1000}, {E_NORMAL, 0, 29, 0x77359400},
+	{E_NORMAL, 0, 33, 0x4A817C80}, {E_NORMAL, 0, 36, 0x5D21DBA0}, {E_NORMAL, 0, 39, 0x746A5288}, {E_NORMAL, 0, 43, 0x48C27395},
+	{E_NORMAL, 0, 46, 0x5AF3107A}, {E_NORMAL, 0, 49, 0x71AFD499}, {E_NORMAL, 0, 53, 0x470DE4E0}, {E_NORMAL, 0, 56, 0x58D15E17},
+	{E_NORMAL, 0, 59, 0x6F05B59D}, {E_NORMAL, 0, 63, 0x45639182}, {E_NORMAL, 0, 66, 0x56BC75E3}, {E_NORMAL, 0, 69, 0x6C6B935C},
+	{E_NORMAL, 0, 73, 0x43C33C19}, {E_NORMAL, 0, 76, 0x54B40B20}, {E_NORMAL, 0, 79, 0x69E10DE7}, {E_NORMAL, 0, 83, 0x422CA8B1},
+	{E_NORMAL, 0, 86, 0x52B7D2DD}, {E_NORMAL, 0, 89, 0x6765C794}, {E_NORMAL, 0, 93, 0x409F9CBC}, {E_NORMAL, 0, 96, 0x50C783EC},
+	{E_NORMAL, 0, 99, 0x64F964E7}, {E_NORMAL, 0, 102, 0x7E37BE20}, {E_NORMAL, 0, 106, 0x4EE2D6D4}, {E_NORMAL, 0, 109, 0x629B8C89},
+	{E_NORMAL, 0, 112, 0x7B426FAB}, {E_NORMAL, 0, 116, 0x4D0985CB}, {E_NORMAL, 0, 119, 0x604BE73E}, {E_NORMAL, 0, 122, 0x785EE10D},
+	{E_NORMAL, 0, 126, 0x4B3B4CA8}, {E_NORMAL, 0, 129, 0x5E0A1FD2}, {E_NORMAL, 0, 132, 0x758CA7C7}, {E_NORMAL, 0, 136, 0x4977E8DC},
+	{E_NORMAL, 0, 139, 0x5BD5E314}, {E_NORMAL, 0, 142, 0x72CB5BD8}, {E_NORMAL, 0, 146, 0x47BF1967}, {E_NORMAL, 0, 149, 0x59AEDFC1},
+	{E_NORMAL, 0, 152, 0x701A97B1}, {E_NORMAL, 0, 156, 0x46109ECF}, {E_NORMAL, 0, 159, 0x5794C683}, {E_NORMAL, 0, 162, 0x6D79F823},
+	{E_NORMAL, 0, 166, 0x446C3B16}, {E_NORMAL, 0, 169, 0x558749DB}, {E_NORMAL, 0, 172, 0x6AE91C52}, {E_NORMAL, 0, 176, 0x42D1B1B3},
+	{E_NORMAL, 0, 179, 0x53861E20}
+};
 
-/* Constants frequently used in these routines */
-static flt_tmp k1, k2, k3, k5, kn1, kn2, kn3, kn5, k10, k100, k1e3, k1e5, k1e8, k1en1, k1en2, k1en3, k1en5, k1en8, k5en1;
+/* 10^n for 0 <= n <= FTOA_MAX_DIGITS as integers */
+static const uint32_t k10u[] = {1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL};
+
+/* 5^n for 0 <= n <= 6, the most that fits in 16 bits */
+static const uint16_t k5u[] = {1U, 5U, 25U, 125U, 625U, 3125U, 15625U};
+
+/* Digit pairs 00 to 99 */
+static const char kpairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
 
 FLT flt_atof(const char *string) {
+	return flt_strtof(string, NULL);
+}
+
+FLT flt_strtof(const char *string, char **end) {
 	FLT result;
-	flt_tmp t, u, v, w;
+	flt_tmp t;
 	E_MODE mode;
 	bool can_continue, has_digits;
-	int exponent, mantissa_sign, exponent_sign;
-	int i;
+	uint32_t mantissa;
+	int digits, scale, exponent, mantissa_sign, exponent_sign;
+	int i, last;
 	mode = E_BEGIN;
+	/* Index past the last character used, stays zero if there is no number */
+	last = 0;
 	can_continue = true;
 	has_digits = false;
-	exponent = mantissa_sign = exponent_sign = 0;
-	flt_tmp_prepare_constants();
+	mantissa = 0;
+	digits = scale = exponent = mantissa_sign = exponent_sign = 0;
 	flt_tmp_init_0(&t);
-	flt_tmp_copy(&v, &k1);
-	flt_tmp_copy(&w, &k1);
 	for (i = 0; can_continue && string[i]; ++i) {
 		switch (tolower(string[i])) {
 			case '+':
@@ -61,6 +166,10 @@ FLT flt_atof(const char *string) {
 					case E_FRACTION:
 						can_continue = false;
 						break;
+					case E_EXPONENT:
+						if (isdigit(string[i - 1]))
+							can_continue = false;
+						break;
 				}
 				break;
 			case '-':
@@ -81,8 +190,9 @@ FLT flt_atof(const char *string) {
 				break;
 			case '.':
 				switch (mode) {
-					case E_BEGIN:
 					case E_INTEGER:
+						last = i + 1;
+					case E_BEGIN:
 						mode = E_FRACTION;
 						break;
 					default:
@@ -104,8 +214,10 @@ FLT flt_atof(const char *string) {
 			case 'i':
 				switch (mode) {
 					case E_BEGIN:
-						if (tolower(string[i + 1]) == 'n' && tolower(string[i + 2]) == 'f')
+						if (tolower(string[i + 1]) == 'n' && tolower(string[i + 2]) == 'f') {
 							flt_tmp_initialize(&t, E_INFINITE, mantissa_sign, 0, 0);
+							last = i + 3;
+						}
 					default:
 						can_continue = false;
 				}
@@ -113,37 +225,48 @@ FLT flt_atof(const char *string) {
 			case 'n':
 				switch (mode) {
 					case E_BEGIN:
-						if (tolower(string[i + 1]) == 'a' && tolower(string[i + 2]) == 'n')
+						if (tolower(string[i + 1]) == 'a' && tolower(string[i + 2]) == 'n') {
 							flt_tmp_init_nan(&t);
+							last = i + 3;
+						}
 					default:
 						can_continue = false;
 				}
 				break;
 			default:
+				/* C99 hexadecimal, e.g. 0x1.8p+3 */
+				if (mode == E_BEGIN && string[i] == '0' && tolower(string[i + 1]) == 'x')
+					return flt_hex_strtof(string, i + 2, mantissa_sign, end);
 				if (isdigit(string[i])) {
 					has_digits = true;
+					last = i + 1;
 					switch (mode) {
 						case E_BEGIN:
 							mode = E_INTEGER;
 						case E_INTEGER:
-							flt_tmp_multiply(&t, &k10);
-							if (string[i] > '0') {
-								flt_tmp_initialize(&u, E_NORMAL, 0, string[i] - '0', TMP_1_BITS);
-								flt_tmp_normalize(&u);
-								flt_tmp_add(&t, &u);
-							}
-							break;
 						case E_FRACTION:
-							flt_tmp_multiply(&v, &k1en1);
-							if (string[i] > '0') {
-								flt_tmp_initialize(&u, E_NORMAL, 0, string[i] - '0', TMP_1_BITS);
-								flt_tmp_normalize(&u);
-								flt_tmp_multiply(&u, &v);
-								flt_tmp_add(&t, &u);
+							/* Accumulate significant digits, leading zeros don't count */
+							if (digits < ATOF_MAX_DIGITS) {
+								if (mantissa || string[i] > '0') {
+									mantissa = 10 * mantissa + string[i] - '0';
+									++digits;
+								}
+								if (mode == E_FRACTION)
+									--scale;
+							} else {
+								/* Round on the first digit dropped, the rest only scale the result */
+								if (digits == ATOF_MAX_DIGITS) {
+									if (string[i] >= '5')
+										++mantissa;
+									++digits;
+								}
+								if (mode == E_INTEGER)
+									++scale;
 							}
 							break;
 						case E_EXPONENT:
-							exponent = 10 * exponent + string[i] - '0';
+							if (exponent < ATOF_MAX_EXPONENT)
+								exponent = 10 * exponent + string[i] - '0';
 							break;
 					}
 					/* Allow leading spaces */
@@ -171,342 +294,747 @@ FLT flt_atof(const char *string) {
 		flt_tmp_init_nan(&t);
 	/* Process for normal, zero, and infinity */
 	if (t.c != E_NAN) {
-		/* Process the sign */
-		if (mantissa_sign)
-			t.s = 1;
 		/* For normal numbers */
-		if (t.c == E_NORMAL) {
+		if (mantissa) {
 			/* Process the exponent */
-			if (exponent_sign)
-				exponent = -exponent;
-			/* Quickly bring small exponents up */
-			while (exponent < 0) {
-				flt_tmp_multiply(&w, &k1en8);
-				exponent += 8;
-			}
-			/* Quickly bring large exponents down */
-			while (exponent >= 8) {
-				flt_tmp_multiply(&w, &k1e8);
-				exponent -= 8;
-			}
-			/* Use Fibonacci sequence to reduce the exponent to zero */
-			if (exponent >= 5) {
-				flt_tmp_multiply(&w, &k1e5);
-				exponent -= 5;
-			}
-			if (exponent >= 3) {
-				flt_tmp_multiply(&w, &k1e3);
-				exponent -= 3;
-			}
-			if (exponent >= 2) {
-				flt_tmp_multiply(&w, &k100);
-				exponent -= 2;
-			}
-			if (exponent >= 1) {
-				flt_tmp_multiply(&w, &k10);
-				--exponent;
+			exponent = (exponent_sign? -exponent: exponent) + scale;
+			/* Convert the digits once */
+			flt_tmp_initialize(&t, E_NORMAL, 0, mantissa, TMP_1_BITS);
+			flt_tmp_normalize(&t);
+			/* Scale the result with a single multiply, out of range goes to zero or infinity */
+			if (exponent < POW10_MIN)
+				flt_tmp_init_0(&t);
+			else if (exponent > POW10_MAX)
+				flt_tmp_initialize(&t, E_INFINITE, 0, 0, 0);
+			else {
+				/* The product is off by a few units in its last bit at most, so only near a midpoint, or as a subnormal,
+				   does it need stepping to the nearest FLT with exact integer compares */
+				flt_tmp_multiply(&t, K10N(exponent));
+				if (t.e < 1 - FLT_E_BIAS || ((t.m & 0x7F) > 0x40 - 0x10 && (t.m & 0x7F) < 0x40 + 0x10)) {
+					tmp_to_flt(&t, &result);
+					result = flt_nearest(result, mantissa, exponent);
+					flt_to_tmp(&result, &t);
+				}
 			}
-			/* Scale the result */
-			flt_tmp_multiply(&t, &w);
 		}
+		/* Process the sign */
+		if (mantissa_sign)
+			t.s = 1;
 	}
+	/* Where parsing stopped */
+	if (end)
+		*end = (char *)string + last;
 	/* Done */
 	tmp_to_flt(&t, &result);
 	return result;
 }
 
-const char *flt_ftoa(const FLT f, const char *format) {
-	flt_tmp t;
-	flt_to_tmp(&f, &t);
-	if (strchr(format, 'e') || strchr(format, 'E'))
-		return flt_tmp_e_format(&t, format);
-	else if (strchr(format, 'f') || strchr(format, 'F'))
-		return flt_tmp_f_format(&t, format);
+/* Hexadecimal digits from index i, then an optional binary exponent, converted with integer operations only */
+static FLT flt_hex_strtof(const char *string, int i, const int sign, char **end) {
+	uint32_t mantissa, result, half, remainder;
+	int exponent, binary_exponent, binary_sign, last, drop, nibble;
+	bool has_digits, fraction, sticky;
+	mantissa = 0;
+	exponent = 0;
+	has_digits = fraction = sticky = false;
+	/* Without any digits only the leading zero is used */
+	last = i - 1;
+	for (; ; ++i) {
+		if (string[i] == '.' && !fraction) {
+			fraction = true;
+			continue;
+		}
+		if (!isxdigit(string[i]))
+			break;
+		has_digits = true;
+		last = i + 1;
+		nibble = isdigit(string[i])? string[i] - '0': tolower(string[i]) - 'a' + 10;
+		/* Keep up to 31 bits, anything past that only matters for rounding */
+		if (mantissa < (1UL << 27)) {
+			mantissa = (mantissa << 4) | nibble;
+			if (fraction)
+				exponent -= 4;
+		} else {
+			sticky |= nibble != 0;
+			if (!fraction)
+				exponent += 4;
+		}
+	}
+	/* Binary exponent, only used if it has digits */
+	if (has_digits && tolower(string[i]) == 'p') {
+		binary_sign = 0;
+		if (string[++i] == '+' || string[i] == '-')
+			binary_sign = string[i++] == '-';
+		for (binary_exponent = 0; isdigit(string[i]); ++i) {
+			if (binary_exponent < ATOF_MAX_EXPONENT)
+				binary_exponent = 10 * binary_exponent + string[i] - '0';
+			last = i + 1;
+		}
+		exponent += binary_sign? -binary_exponent: binary_exponent;
+	}
+	if (end)
+		*end = (char *)string + last;
+	if (!mantissa)
+		return sign? FLT_NEG_0: FLT_POS_0;
+	/* Normalize to the top bit, the value is then 1.xxx * 2^(exponent + 31) */
+	for (; !(mantissa & FLT_S_MASK); --exponent)
+		mantissa <<= 1;
+	exponent += 31;
+	if (exponent > FLT_E_BIAS)
+		return sign? FLT_NEG_INF: FLT_POS_INF;
+	/* Drop the bits below the 24 bit mantissa, more for subnormals */
+	drop = (exponent >= 1 - FLT_E_BIAS)? 8: 8 + 1 - FLT_E_BIAS - exponent;
+	if (drop > 32)
+		return sign? FLT_NEG_0: FLT_POS_0;
+	result = (drop < 32)? mantissa >> drop: 0;
+	half = 1UL << (drop - 1);
+	remainder = (drop < 32)? mantissa & ((half << 1) - 1): mantissa;
+	/* Round to nearest, ties to even */
+	if (remainder > half || (remainder == half && (sticky || (result & 1))))
+		++result;
+	/* Normal, the implicit bit adds one to the exponent and any carry rolls into it */
+	if (exponent >= 1 - FLT_E_BIAS)
+		result += (uint32_t)(exponent + FLT_E_BIAS - 1) << FLT_M_BITS;
+	return sign? result | FLT_S_MASK: result;
+}
+
+/* Step from positive f, within an ulp or so of n * 10^exponent, to the nearest FLT, ties to even */
+static FLT flt_nearest(FLT f, const uint32_t n, const int exponent) {
+	int compare;
+	while (f < FLT_POS_INF && ((compare = flt_midpoint_compare(n, exponent, f)) > 0 || (!compare && (f & 1))))
+		++f;
+	while (f > FLT_POS_0 && ((compare = flt_midpoint_compare(n, exponent, f - 1)) < 0 || (!compare && (f & 1))))
+		--f;
+	return f;
+}
+
+/* Exact compare of n * 10^exponent with the midpoint between positive f and the next FLT up */
+static int flt_midpoint_compare(const uint32_t n, const int exponent, const FLT f) {
+	flt_big b, c;
+	uint32_t mantissa;
+	int base_2_exponent;
+	mantissa = f & FLT_M_MASK;
+	base_2_exponent = flt_exponent(f);
+	if (base_2_exponent < 1 - FLT_E_BIAS)
+		base_2_exponent = 1 - FLT_E_BIAS;
 	else
-		return flt_tmp_g_format(&t, format);
+		mantissa |= FLT_M_MASK + 1;
+	/* The midpoint is (2 * mantissa + 1) * 2^base_2_exponent */
+	base_2_exponent -= FLT_M_BITS + 1;
+	flt_big_set(&b, n);
+	flt_big_set(&c, 2 * mantissa + 1);
+	flt_big_scale(&b, exponent, exponent - base_2_exponent);
+	flt_big_scale(&c, -exponent, base_2_exponent - exponent);
+	return flt_big_compare(&b, &c);
 }
 
-static const char *flt_tmp_e_format(flt_tmp *pt, const char *format) {
-	/* Formats recognized: /%\+?(\.[0-9])?[EeGg]/ */
-	/* Using a larger buffer to allow multiple calls in one printf statement, i.e. up to 15. */
-	static char _strings[FMT_E_BFR_LEN];
-	static int _index = 0;
-	flt_tmp u;
-	char *string;
-	int base_10_exponent, precision, i, j;
-	/* Advance the index */
-	string = _strings + _index;
-	_index = (_index + FMT_E_MAX_LEN) % FMT_E_BFR_LEN;
-	/* Continue */
-	i = 0;
-	precision = printf_precision(format);
-	if (pt->c == E_NORMAL) {
-		flt_tmp_prepare_constants();
-		flt_tmp_initialize(&u, pt->c, 0, pt->m, pt->e);
-		/* Initial sign */
-		string[i++] = "+-"[pt->s];
-		/* Mantissa */
-		base_10_exponent = flt_tmp_normalize_to_base_10(&u, precision, E_AFTER);
-		/* First digit */
-		string[i++] = flt_tmp_get_next_digit(&u);
-		string[i++] = '.';
-		/* Rest of the digits */
-		for (j = 0; j < precision; ++j)
-			string[i++] = flt_tmp_get_next_digit(&u);
-		/* Exponent */
-		string[i++] = 'e';
-		string[i++] = (base_10_exponent < 0)? '-': '+';
-		if (base_10_exponent < 0)
-			base_10_exponent = -base_10_exponent;
-		string[i++] = '0' + base_10_exponent / 10;
-		string[i++] = '0' + base_10_exponent % 10;
-		/* Done */
-		string[i] = '\0';
-	} else {
-		switch (pt->c) {
-			case E_INFINITE:
-				strcpy(string, pt->s? "-inf": "+inf");
-				break;
-			case E_NAN:
-				strcpy(string, "nan");
-				break;
-			case E_ZERO:
-				strcpy(string, pt->s? "-0.": "+0.");
-				strncat(string, "000000000", precision);
-				strcat(string, "e+00");
-				break;
+int flt_parse_array(const char *string, FLT *values, const int count) {
+	char *end;
+	int i, j;
+	/* Destination can't be NULL */
+	if (values == NULL)
+		exit(EXIT_FAILURE);
+	for (i = 0; i < count; ++i) {
+		/* Skip whitespace, the only separator, like "%f %f" in sscanf */
+		for (; isspace(*string); ++string)
+			;
+		/* Like sscanf, running out of input before the first value is EOF */
+		if (!i && !*string) {
+			i = EOF;
+			break;
 		}
+		values[i] = flt_strtof(string, &end);
+		/* Stop at the first thing that isn't a number */
+		if (end == string)
+			break;
+		string = end;
 	}
-	return printf_post_process(string, format, precision);
+	/* Unread values are NaN, like unmatched FLT parameters in *scanf */
+	for (j = (i == EOF)? 0: i; j < count; ++j)
+		values[j] = FLT_NAN;
+	return i;
 }
 
-static const char *flt_tmp_f_format(flt_tmp *pt, const char *format) {
-	/* Formats recognized: /%\+?(\.[0-9])?[FfGg]/ */
-	/* Using a larger buffer to allow multiple calls in one printf statement, i.e. up to 5. */
-	static char _strings[FMT_F_BFR_LEN];
-	static int _index = 0;
-	flt_tmp u;
-	char *string;
-	int base_10_exponent, precision, maximum_digits, limit, i, j;
-	/* Advance the index */
-	string = _strings + _index;
-	_index = (_index + FMT_F_MAX_LEN) % FMT_F_BFR_LEN;
-	/* Continue */
-	precision = printf_precision(format);
-	if (pt->c == E_NORMAL) {
-		i = 0;
-		maximum_digits = 10;
-		flt_tmp_prepare_constants();
-		flt_tmp_initialize(&u, pt->c, 0, pt->m, pt->e);
-		/* Initial sign */
-		string[i++] = "+-"[pt->s];
-		base_10_exponent = flt_tmp_normalize_to_base_10(&u, precision, E_BEFORE);
-		/* Numbers one or higher */
-		if (base_10_exponent >= 0) {
-			/* Integer */
-			string[i++] = (maximum_digits-- > 0)? flt_tmp_get_next_digit(&u): '0';
-			for (j = 0; j < base_10_exponent; ++j)
-				string[i++] = (maximum_digits-- > 0)? flt_tmp_get_next_digit(&u): '0';
-			string[i++] = '.';
-			/* Fraction */
-			for (j = 0; j < precision; ++j)
-				string[i++] = (maximum_digits-- > 0)? flt_tmp_get_next_digit(&u): '0';
-			/* Numbers less than one */
-		} else {
-			string[i++] = '0';
-			string[i++] = '.';
-			for (j = 0, limit = -base_10_exponent - 1; j < limit; ++j)
-				string[i++] = '0';
-			for (j = 0, limit = precision + base_10_exponent + 1; j < limit; ++j)
-				string[i++] = (maximum_digits-- > 0)? flt_tmp_get_next_digit(&u): '0';
-		}
-		/* Done */
-		string[i] = '\0';
-	} else {
-		switch (pt->c) {
-			case E_INFINITE:
-				strcpy(string, pt->s? "-inf": "+inf");
-				break;
-			case E_NAN:
-				strcpy(string, "nan");
-				break;
-			case E_ZERO:
-				strcpy(string, pt->s? "-0.": "+0.");
-				strncat(string, "000000000", precision);
-				break;
-		}
+#ifndef	FLT_NO_RING_BUFFERS
+const char *flt_ftoa(const FLT f, const char *format) {
+	return flt_ftoa_fmt(f, flt_spec(format));
+}
+
+const char *flt_ftoa_fmt(const FLT f, const unsigned spec) {
+	/* Using larger buffers to allow multiple calls in one printf statement, i.e. up to 15 "E" or "R", or 5 "F" */
+	static char _e_strings[FMT_E_BFR_LEN], _f_strings[FMT_F_BFR_LEN], _r_strings[FMT_R_BFR_LEN];
+	static int _e_index = 0, _f_index = 0, _r_index = 0;
+	flt_tmp t;
+	flt_sink sink;
+	E_STYLE style;
+	int base_10_exponent;
+	flt_to_tmp(&f, &t);
+	style = flt_tmp_style(&t, spec, &base_10_exponent);
+	flt_sink_initialize(&sink, spec);
+	/* Advance the index of the ring for the style */
+	switch (style) {
+		case E_STYLE_E:
+		case E_STYLE_A:
+			sink.string = _e_strings + _e_index;
+			sink.length = FMT_E_MAX_LEN;
+			_e_index = (_e_index + FMT_E_MAX_LEN) % FMT_E_BFR_LEN;
+			break;
+		case E_STYLE_F:
+			sink.string = _f_strings + _f_index;
+			sink.length = FMT_F_MAX_LEN;
+			_f_index = (_f_index + FMT_F_MAX_LEN) % FMT_F_BFR_LEN;
+			break;
+		default:
+			sink.string = _r_strings + _r_index;
+			sink.length = FMT_R_MAX_LEN;
+			_r_index = (_r_index + FMT_R_MAX_LEN) % FMT_R_BFR_LEN;
+			break;
 	}
-	return printf_post_process(string, format, precision);
+	flt_tmp_emit(f, &t, spec, style, base_10_exponent, &sink);
+	return sink.string;
 }
 
-static const char *flt_tmp_g_format(flt_tmp *pt, const char *format) {
-	flt_tmp u;
-	/* Shortcut to handle zero */
-	if (pt->c == E_ZERO)
-		return flt_tmp_f_format(pt, format);
-	flt_tmp_prepare_constants();
-	flt_tmp_initialize(&u, pt->c, 0, pt->m, pt->e);
-	return flt_tmp_compare(&u, &k1e5, E_GREATER_THAN_OR_EQUAL_TO) || flt_tmp_compare(&u, &k1en5, E_LESS_THAN)?
-		flt_tmp_e_format(pt, format): flt_tmp_f_format(pt, format);
+const char *flt_ftoa_shortest(const FLT f) {
+	return flt_ftoa_fmt(f, FLT_FMT_R);
 }
+#endif	/* FLT_NO_RING_BUFFERS */
 
-static int flt_tmp_normalize_to_base_10(flt_tmp *pt, int precision, const E_ROUNDING rounding) {
-	int base_10_exponent = 0;
-	flt_tmp u;
-	/* Input is expected to be normal and non-negative */
-	if (pt->c != E_NORMAL || pt->s)
+size_t flt_ftoa_r(const FLT f, const char *format, char *buffer, const size_t length) {
+	return flt_ftoa_fmt_r(f, flt_spec(format), buffer, length);
+}
+
+size_t flt_ftoa_fmt_r(const FLT f, const unsigned spec, char *buffer, const size_t length) {
+	flt_tmp t;
+	flt_sink sink;
+	E_STYLE style;
+	int base_10_exponent;
+	/* Destination can't be NULL */
+	if (buffer == NULL)
+		exit(EXIT_FAILURE);
+	flt_to_tmp(&f, &t);
+	flt_sink_initialize(&sink, spec);
+	sink.string = buffer;
+	sink.length = length;
+	style = flt_tmp_style(&t, spec, &base_10_exponent);
+	flt_tmp_emit(f, &t, spec, style, base_10_exponent, &sink);
+	return sink.count;
+}
+
+int flt_fputf(FILE *stream, const FLT f, const char *format) {
+	flt_tmp t;
+	flt_sink sink;
+	E_STYLE style;
+	unsigned spec;
+	int base_10_exponent;
+	/* Destination can't be NULL */
+	if (stream == NULL)
 		exit(EXIT_FAILURE);
-	/* Get rounding, i.e. start with half and divide down by the precision.
-	   The reason we're not using Banker's rounding here is because in testing,
-	   Banker's rounding rarely made a difference. Most of the time the input is
-	   multiplied by one or more of k1en8, k1en5, k1en3, k1en2, or k1en1 which
-	   don't have "clean" representations in base 2, so the input rarely has
-	   terminating 0s. Not worth the trouble for the few cases where it might
-	   apply!
-	*/
-	flt_tmp_copy(&u, &k5en1);
-	if (precision >= 5) {
-		flt_tmp_multiply(&u, &k1en5);
-		precision -= 5;
+	flt_to_tmp(&f, &t);
+	spec = flt_spec(format);
+	flt_sink_initialize(&sink, spec);
+	sink.stream = stream;
+	style = flt_tmp_style(&t, spec, &base_10_exponent);
+	flt_tmp_emit(f, &t, spec, style, base_10_exponent, &sink);
+	return sink.failed? EOF: (int)sink.count;
+}
+
+size_t flt_emit(const FLT f, const char *format, void (*put_char)(char)) {
+	flt_tmp t;
+	flt_sink sink;
+	E_STYLE style;
+	unsigned spec;
+	int base_10_exponent;
+	/* Destination can't be NULL */
+	if (put_char == NULL)
+		exit(EXIT_FAILURE);
+	flt_to_tmp(&f, &t);
+	spec = flt_spec(format);
+	flt_sink_initialize(&sink, spec);
+	sink.put_char = put_char;
+	style = flt_tmp_style(&t, spec, &base_10_exponent);
+	flt_tmp_emit(f, &t, spec, style, base_10_exponent, &sink);
+	return sink.count;
+}
+
+/* Decide the layout, also finding the decimal exponent of normal values once for all of them. "G" uses "E"
+   for very large or very small values. */
+static E_STYLE flt_tmp_style(const flt_tmp *pt, const unsigned spec, int *base_10_exponent) {
+	*base_10_exponent = (pt->c == E_NORMAL && (spec & FLT_FMT_STYLE) != FLT_FMT_A)? flt_tmp_base_10_exponent(pt): 0;
+	switch (spec & FLT_FMT_STYLE) {
+		case FLT_FMT_R:
+			return E_STYLE_R;
+		case FLT_FMT_A:
+			return E_STYLE_A;
+		case FLT_FMT_E:
+			return E_STYLE_E;
+		case FLT_FMT_F:
+			return E_STYLE_F;
 	}
-	if (precision >= 3) {
-		flt_tmp_multiply(&u, &k1en3);
-		precision -= 3;
+	return (pt->c == E_NORMAL && (*base_10_exponent >= 5 || *base_10_exponent < -5))? E_STYLE_E: E_STYLE_F;
+}
+
+/* Emit t in the given style, terminating the string if that is the destination */
+static void flt_tmp_emit(const FLT f, const flt_tmp *pt, const unsigned spec, const E_STYLE style, const int base_10_exponent, flt_sink *ps) {
+	switch (pt->c) {
+		case E_INFINITE:
+			flt_sink_put_sign(ps, pt, spec);
+			flt_sink_put_string(ps, "inf");
+			break;
+		case E_NAN:
+			flt_sink_put_string(ps, "nan");
+			break;
+		default:
+			switch (style) {
+				case E_STYLE_E:
+					flt_tmp_e_emit(pt, spec, base_10_exponent, ps);
+					break;
+				case E_STYLE_F:
+					flt_tmp_f_emit(pt, spec, base_10_exponent, ps);
+					break;
+				case E_STYLE_A:
+					flt_a_emit(f, spec, ps);
+					break;
+				default:
+					flt_r_emit(f, pt, spec, base_10_exponent, ps);
+					break;
+			}
+			break;
 	}
-	if (precision >= 2) {
-		flt_tmp_multiply(&u, &k1en2);
-		precision -= 2;
+	if (ps->string && ps->length)
+		ps->string[(ps->count < ps->length)? ps->count: ps->length - 1] = '\0';
+}
+
+static void flt_tmp_e_emit(const flt_tmp *pt, const unsigned spec, int base_10_exponent, flt_sink *ps) {
+	/* Formats recognized: /%\+?(\.[0-9])?[EeGg]/ */
+	char digits[10];
+	uint32_t n;
+	int precision, count;
+	precision = spec_precision(spec);
+	if (pt->c == E_NORMAL) {
+		/* Scale once to an integer with the required number of significant digits */
+		count = (precision < FTOA_MAX_DIGITS)? precision + 1: FTOA_MAX_DIGITS;
+		n = flt_tmp_scale_to_integer(pt, count - 1 - base_10_exponent);
+		/* Rounding up can carry into another digit, e.g. 9.99 to 10.0 */
+		if (n >= k10u[count])
+			n = flt_tmp_scale_to_integer(pt, count - 1 - ++base_10_exponent);
+		uint_to_digits(digits, n, count);
+	} else {
+		/* Zero */
+		base_10_exponent = 0;
+		count = 1;
+		digits[0] = '0';
 	}
-	if (precision >= 1) {
-		flt_tmp_multiply(&u, &k1en1);
-		precision -= 1;
+	/* First digit, then the fraction padded past the maximum digits */
+	flt_sink_put_sign(ps, pt, spec);
+	flt_sink_put(ps, digits[0]);
+	flt_sink_put_fraction(ps, digits + 1, count - 1, precision, spec);
+	/* Exponent */
+	flt_sink_put(ps, 'e');
+	flt_sink_put(ps, (base_10_exponent < 0)? '-': '+');
+	if (base_10_exponent < 0)
+		base_10_exponent = -base_10_exponent;
+	flt_sink_put(ps, '0' + base_10_exponent / 10);
+	flt_sink_put(ps, '0' + base_10_exponent % 10);
+}
+
+static void flt_tmp_f_emit(const flt_tmp *pt, const unsigned spec, const int base_10_exponent, flt_sink *ps) {
+	/* Formats recognized: /%\+?(\.[0-9])?[FfGg]/ */
+	char digits[10];
+	uint32_t n;
+	int precision, scale, count, j;
+	precision = spec_precision(spec);
+	if (pt->c == E_NORMAL) {
+		/* Scale once to an integer, limiting the significant digits for large numbers */
+		scale = (base_10_exponent + 1 + precision > FTOA_MAX_DIGITS)? FTOA_MAX_DIGITS - 1 - base_10_exponent: precision;
+		n = flt_tmp_scale_to_integer(pt, scale);
+		/* Rounding up can carry into another digit */
+		if (n >= k10u[FTOA_MAX_DIGITS])
+			n = flt_tmp_scale_to_integer(pt, --scale);
+	} else {
+		/* Zero */
+		n = 0;
+		scale = precision;
 	}
-	/* Add rounding before, if specified */
-	if (rounding == E_BEFORE)
-		flt_tmp_add(pt, &u);
-	/* Quickly bring small numbers up */
-	while (flt_tmp_compare(pt, &k1, E_LESS_THAN)) {
-		flt_tmp_multiply(pt, &k1e8);
-		base_10_exponent -= 8;
+	flt_sink_put_sign(ps, pt, spec);
+	if (scale > 0) {
+		/* The last scale digits are the fraction, with at least one integer digit */
+		count = uint_to_digits(digits, n, scale + 1);
+		for (j = 0; j < count - scale; ++j)
+			flt_sink_put(ps, digits[j]);
+		flt_sink_put_fraction(ps, digits + count - scale, scale, precision, spec);
+	} else {
+		/* Trailing zeros in the integer */
+		count = uint_to_digits(digits, n, 1);
+		for (j = 0; j < count; ++j)
+			flt_sink_put(ps, digits[j]);
+		for (j = scale; j < 0; ++j)
+			flt_sink_put(ps, '0');
+		flt_sink_put_fraction(ps, digits, 0, precision, spec);
 	}
-	/* Quickly bring large numbers down */
-	while (flt_tmp_compare(pt, &k1e8, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_multiply(pt, &k1en8);
-		base_10_exponent += 8;
+}
+
+static void flt_a_emit(const FLT f, const unsigned spec, flt_sink *ps) {
+	/* Formats recognized: /%\+?[Aa]/, always exact so any precision is ignored */
+	char digits[10];
+	uint32_t mantissa;
+	int exponent, count, i;
+	if (f & FLT_S_MASK)
+		flt_sink_put(ps, '-');
+	else if (spec & FLT_FMT_PLUS)
+		flt_sink_put(ps, '+');
+	flt_sink_put_string(ps, "0x");
+	mantissa = f & FLT_M_MASK;
+	exponent = flt_exponent(f);
+	if (!(f & ~FLT_S_MASK)) {
+		flt_sink_put(ps, '0');
+		exponent = 0;
+	} else {
+		/* Subnormals are normalized, so the leading digit is always one */
+		if (exponent < 1 - FLT_E_BIAS)
+			for (exponent = 1 - FLT_E_BIAS; !(mantissa & (FLT_M_MASK + 1)); --exponent)
+				mantissa <<= 1;
+		flt_sink_put(ps, '1');
+		/* The 23 bit fraction shifted up to fill six nibbles, trailing zeros dropped */
+		mantissa = (mantissa & FLT_M_MASK) << 1;
+		if (mantissa)
+			flt_sink_put(ps, '.');
+		for (i = 20; mantissa; i -= 4) {
+			flt_sink_put(ps, "0123456789abcdef"[(mantissa >> i) & 0xF]);
+			mantissa &= (1UL << i) - 1;
+		}
 	}
-	/* Normalize to 1 <= t < 10 */
-	if (flt_tmp_compare(pt, &k1e5, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_multiply(pt, &k1en5);
-		base_10_exponent += 5;
+	/* Binary exponent in decimal */
+	flt_sink_put(ps, 'p');
+	flt_sink_put(ps, (exponent < 0)? '-': '+');
+	count = uint_to_digits(digits, (exponent < 0)? -exponent: exponent, 1);
+	for (i = 0; i < count; ++i)
+		flt_sink_put(ps, digits[i]);
+}
+
+static void flt_r_emit(const FLT f, const flt_tmp *pt, const unsigned spec, const int base_10_exponent, flt_sink *ps) {
+	/* Formats recognized: /%\+?[Rr]/ */
+	char digits[FTOA_MAX_DIGITS + 1];
+	int count, exponent, fixed, j;
+	flt_sink_put_sign(ps, pt, spec);
+	if (pt->c != E_NORMAL) {
+		/* Zero */
+		flt_sink_put(ps, '0');
+		return;
 	}
-	if (flt_tmp_compare(pt, &k1e3, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_multiply(pt, &k1en3);
-		base_10_exponent += 3;
+	count = flt_r_digits(f, base_10_exponent, digits, &exponent);
+	/* Length of the "F" layout compared with the "E" layout, whichever is shorter */
+	if (exponent < 0)
+		fixed = count + 1 - exponent;
+	else
+		fixed = (count > exponent + 1)? count + 1: exponent + 1;
+	if (fixed <= count + (count > 1) + 4) {
+		if (exponent < 0) {
+			flt_sink_put(ps, '0');
+			flt_sink_put(ps, '.');
+			for (j = exponent; j < -1; ++j)
+				flt_sink_put(ps, '0');
+			for (j = 0; j < count; ++j)
+				flt_sink_put(ps, digits[j]);
+		} else {
+			for (j = 0; j < count || j <= exponent; ++j) {
+				if (j == exponent + 1)
+					flt_sink_put(ps, '.');
+				flt_sink_put(ps, (j < count)? digits[j]: '0');
+			}
+		}
+	} else {
+		flt_sink_put(ps, digits[0]);
+		flt_sink_put_fraction(ps, digits + 1, count - 1, count - 1, spec);
+		flt_sink_put(ps, 'e');
+		flt_sink_put(ps, (exponent < 0)? '-': '+');
+		if (exponent < 0)
+			exponent = -exponent;
+		flt_sink_put(ps, '0' + exponent / 10);
+		flt_sink_put(ps, '0' + exponent % 10);
 	}
-	if (flt_tmp_compare(pt, &k100, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_multiply(pt, &k1en2);
-		base_10_exponent += 2;
+}
+
+/* Shortest digits that read back as positive f, generated one at a time from the exact rounding interval with
+   integer arithmetic only, as in Steele & White or Burger & Dybvig. Returns the count of digits, with the exponent
+   of the first digit in *pexponent. */
+static int flt_r_digits(const FLT f, int base_10_exponent, char *digits, int *pexponent) {
+	flt_big r, s, upper, lower, u;
+	uint32_t mantissa;
+	int base_2_exponent, count, compare, d;
+	bool inclusive, low, high;
+	/* f is 4 * mantissa * 2^base_2_exponent, with the midpoints to its neighbours 2 above and 2 below, or 1 below
+	   at a power of two where the lower neighbour is closer */
+	mantissa = f & FLT_M_MASK;
+	base_2_exponent = flt_exponent(f);
+	if (base_2_exponent < 1 - FLT_E_BIAS)
+		base_2_exponent = 1 - FLT_E_BIAS;
+	else
+		mantissa |= FLT_M_MASK + 1;
+	base_2_exponent -= FLT_M_BITS + 2;
+	flt_big_set(&r, mantissa << 2);
+	flt_big_set(&upper, 2);
+	flt_big_set(&lower, (!(f & FLT_M_MASK) && (f >> FLT_M_BITS) > 1)? 1: 2);
+	flt_big_set(&s, 1);
+	/* Scale so r / s is f / 10^base_10_exponent, keeping everything whole */
+	flt_big_scale(&r, -base_10_exponent, base_2_exponent - base_10_exponent);
+	flt_big_scale(&upper, -base_10_exponent, base_2_exponent - base_10_exponent);
+	flt_big_scale(&lower, -base_10_exponent, base_2_exponent - base_10_exponent);
+	flt_big_scale(&s, base_10_exponent, base_10_exponent - base_2_exponent);
+	/* The exponent came from rounded powers of ten, so make sure 1 <= r / s < 10 */
+	if (flt_big_compare(&r, &s) < 0) {
+		flt_big_multiply(&r, 10);
+		flt_big_multiply(&upper, 10);
+		flt_big_multiply(&lower, 10);
+		--base_10_exponent;
+	} else {
+		u = s;
+		flt_big_multiply(&u, 10);
+		if (flt_big_compare(&r, &u) >= 0) {
+			s = u;
+			++base_10_exponent;
+		}
 	}
-	if (flt_tmp_compare(pt, &k10, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_multiply(pt, &k1en1);
-		++base_10_exponent;
+	/* The rounding interval itself reads back as f if the mantissa is even */
+	inclusive = !(mantissa & 1);
+	for (count = 0; ; ) {
+		for (d = 0; flt_big_compare(&r, &s) >= 0; ++d)
+			flt_big_subtract(&r, &s);
+		/* Stop once the digits so far, or the same with the last one more, are in the interval */
+		compare = flt_big_compare(&r, &lower);
+		low = compare < 0 || (inclusive && !compare);
+		u = r;
+		flt_big_add(&u, &upper);
+		compare = flt_big_compare(&u, &s);
+		high = compare > 0 || (inclusive && !compare);
+		/* Both are, so take the nearer, ties to even */
+		if (low && high) {
+			u = r;
+			flt_big_add(&u, &r);
+			compare = flt_big_compare(&u, &s);
+			high = compare > 0 || (!compare && (d & 1));
+		}
+		digits[count++] = '0' + d + high;
+		if (low || high)
+			break;
+		flt_big_multiply(&r, 10);
+		flt_big_multiply(&upper, 10);
+		flt_big_multiply(&lower, 10);
 	}
-	/* Add rounding after, if specified */
-	if (rounding == E_AFTER)
-		flt_tmp_add(pt, &u);
-	/* Last check for rounding issues */
-	if (flt_tmp_compare(pt, &k10, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_multiply(pt, &k1en1);
+	/* Only a single 9 can round up, since otherwise the previous digit would have stopped */
+	if (digits[0] > '9') {
+		digits[0] = '1';
 		++base_10_exponent;
 	}
-	if (flt_tmp_compare(pt, &k1, E_LESS_THAN)) {
-		flt_tmp_multiply(pt, &k10);
+	*pexponent = base_10_exponent;
+	return count;
+}
+
+/* Exact floor(log10(t)) of a positive normal t */
+static int flt_tmp_base_10_exponent(const flt_tmp *pt) {
+	/* Estimate log2(t) from e and the top seven fraction bits, then times log10(2) as 77/256 to stay within 16 bits */
+	int estimate = pt->e * 77 + ((int)((pt->m >> (TMP_1_BITS - 7)) & 0x7F) * 77 >> 7);
+	int base_10_exponent = (estimate >= 0)? estimate >> 8: -((-estimate + 255) >> 8);
+	/* The estimate is within one either way, so one compare against the table corrects it */
+	if (flt_tmp_less_than(pt, K10N(base_10_exponent)))
 		--base_10_exponent;
-	}
-	/* Return the base 10 exponent */
+	else if (!flt_tmp_less_than(pt, K10N(base_10_exponent + 1)))
+		++base_10_exponent;
 	return base_10_exponent;
 }
 
-static char flt_tmp_get_next_digit(flt_tmp *pt) {
-	char digit = '0';
-	/* Short circuit for zero */
-	if (pt->c == E_ZERO)
-		return digit;
-	/* Use the Fibonacci sequence to extract the digit in fewer operations */
-	if (flt_tmp_compare(pt, &k5, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_add(pt, &kn5);
-		digit += 5;
-	}
-	if (flt_tmp_compare(pt, &k3, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_add(pt, &kn3);
-		digit += 3;
+/* Quick compare of positive normal values, no subtraction required */
+static bool flt_tmp_less_than(const flt_tmp *pt, const flt_tmp *pu) {
+	return pt->e < pu->e || (pt->e == pu->e && pt->m < pu->m);
+}
+
+/* Multiply t by 10^scale and round to an integer. The reason we're not using
+   Banker's rounding here is because 10^scale rarely has a "clean" representation
+   in base 2, so the product rarely lands exactly on a half. Not worth the
+   trouble for the few cases where it might apply! */
+static uint32_t flt_tmp_scale_to_integer(const flt_tmp *pt, const int scale) {
+	flt_tmp u;
+	flt_tmp_initialize(&u, E_NORMAL, 0, pt->m, pt->e);
+	flt_tmp_multiply(&u, K10N(scale));
+	/* Less than a half rounds to zero */
+	if (u.e < -1)
+		return 0;
+	/* Callers keep the result below 2^30, so -1 <= e < TMP_1_BITS here */
+	return (u.m + (1UL << (TMP_1_BITS - 1 - u.e))) >> (TMP_1_BITS - u.e);
+}
+
+/* Convenience function to write the decimal digits of n, zero padded to at least width digits, returns the count */
+static int uint_to_digits(char *string, uint32_t n, const int width) {
+	char digits[10];
+	uint16_t chunk;
+	int i;
+	/* Split into chunks of four digits with 32 bit division, then into pairs with 16 bit division */
+	for (i = sizeof(digits); i > 0; i -= 4) {
+		chunk = (uint16_t)(n % 10000UL);
+		n /= 10000UL;
+		memcpy(digits + i - 2, kpairs + 2 * (chunk % 100), 2);
+		if (i > 2)
+			memcpy(digits + i - 4, kpairs + 2 * (chunk / 100), 2);
 	}
-	if (flt_tmp_compare(pt, &k2, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_add(pt, &kn2);
-		digit += 2;
+	/* Skip leading zeros */
+	for (i = 0; i < (int)sizeof(digits) - width && i < (int)sizeof(digits) - 1 && digits[i] == '0'; ++i)
+		;
+	memcpy(string, digits + i, sizeof(digits) - i);
+	return sizeof(digits) - i;
+}
+
+/* Convenience function to pack a printf style format into a specification, precision defaults to 6 */
+static unsigned flt_spec(const char *format) {
+	char *decimal_marker = strchr(format, '.');
+	unsigned spec;
+	long precision;
+	if (strchr(format, 'r') || strchr(format, 'R'))
+		spec = FLT_FMT_R;
+	else if (strchr(format, 'a') || strchr(format, 'A'))
+		spec = FLT_FMT_A;
+	else if (strchr(format, 'e') || strchr(format, 'E'))
+		spec = FLT_FMT_E;
+	else if (strchr(format, 'f') || strchr(format, 'F'))
+		spec = FLT_FMT_F;
+	else
+		spec = FLT_FMT_G;
+	if (strchr(format, 'E') || strchr(format, 'F') || strchr(format, 'G') || strchr(format, 'R') || strchr(format, 'A'))
+		spec |= FLT_FMT_UPPER;
+	if (strchr(format, '+'))
+		spec |= FLT_FMT_PLUS;
+	/* Precision as in printf, "." alone is zero, and "*" or a missing precision is the default */
+	precision = (decimal_marker && decimal_marker[1] != '*' && decimal_marker[1] != '-')? strtol(decimal_marker + 1, NULL, 10): 6;
+	return spec | (precision > 9? 9: precision);
+}
+
+/* Convenience function to return numeric precision, no more than the maximum digits */
+static int spec_precision(const unsigned spec) {
+	return ((spec & FLT_FMT_PRECISION) < FTOA_MAX_DIGITS)? spec & FLT_FMT_PRECISION: FTOA_MAX_DIGITS;
+}
+
+/* Convenience function to start a sink with the case given by the specification */
+static void flt_sink_initialize(flt_sink *ps, const unsigned spec) {
+	memset(ps, 0, sizeof(flt_sink));
+	ps->upper = (spec & FLT_FMT_UPPER) != 0;
+}
+
+/* Convenience function to emit one character, strings are truncated to fit but still counted like snprintf */
+static void flt_sink_put(flt_sink *ps, char c) {
+	if (ps->upper)
+		c = toupper(c);
+	if (ps->string) {
+		if (ps->count + 1 < ps->length)
+			ps->string[ps->count] = c;
+	} else if (ps->stream) {
+		if (putc(c, ps->stream) == EOF)
+			ps->failed = true;
+	} else
+		ps->put_char(c);
+	++ps->count;
+}
+
+/* Convenience function to emit a null terminated string */
+static void flt_sink_put_string(flt_sink *ps, const char *string) {
+	for (; *string; ++string)
+		flt_sink_put(ps, *string);
+}
+
+/* Convenience function to emit the sign, plus only if the format asks for it */
+static void flt_sink_put_sign(flt_sink *ps, const flt_tmp *pt, const unsigned spec) {
+	if (pt->s || (spec & FLT_FMT_PLUS))
+		flt_sink_put(ps, "+-"[pt->s]);
+}
+
+/* Convenience function to emit the decimal marker and precision digits of fraction, padding with zeros past the count
+   available. "G" drops trailing zeros, and the decimal marker too if nothing is left. */
+static void flt_sink_put_fraction(flt_sink *ps, const char *digits, const int count, int precision, const unsigned spec) {
+	int i;
+	if ((spec & FLT_FMT_STYLE) == FLT_FMT_G)
+		for (precision = (precision < count)? precision: count; precision > 0 && digits[precision - 1] == '0'; --precision)
+			;
+	if (precision > 0) {
+		flt_sink_put(ps, '.');
+		for (i = 0; i < precision; ++i)
+			flt_sink_put(ps, (i < count)? digits[i]: '0');
 	}
-	if (flt_tmp_compare(pt, &k1, E_GREATER_THAN_OR_EQUAL_TO)) {
-		flt_tmp_add(pt, &kn1);
-		++digit;
+}
+
+/* Convenience function to set b to n */
+static void flt_big_set(flt_big *pb, const uint32_t n) {
+	memset(pb, 0, sizeof(flt_big));
+	pb->w[0] = (uint16_t)n;
+	pb->w[1] = (uint16_t)(n >> 16);
+	pb->n = pb->w[1]? 2: (pb->w[0]? 1: 0);
+}
+
+/* Convenience function to multiply b by n, 16 x 16 bits at a time */
+static void flt_big_multiply(flt_big *pb, const uint16_t n) {
+	uint32_t carry;
+	int i;
+	for (carry = 0, i = 0; i < pb->n; ++i) {
+		carry += (uint32_t)pb->w[i] * n;
+		pb->w[i] = (uint16_t)carry;
+		carry >>= 16;
 	}
-	/* Advance to the next digit */
-	flt_tmp_multiply(pt, &k10);
-	/* Done */
-	return digit;
+	if (carry)
+		pb->w[pb->n++] = (uint16_t)carry;
 }
 
-/* Convenience function to return numeric precision */
-static int printf_precision(const char *format) {
-	char *decimal_marker = strchr(format, '.');
-	/* Default to 6 if no decimal marker */
-	return decimal_marker && isdigit(decimal_marker[1])? decimal_marker[1] - '0': 6;
+/* Convenience function to multiply b by 5^base_5_exponent * 2^base_2_exponent. Negative exponents are skipped, the
+   caller scales the other side of the comparison by them instead. */
+static void flt_big_scale(flt_big *pb, int base_5_exponent, int base_2_exponent) {
+	int i;
+	for (; base_5_exponent > 6; base_5_exponent -= 6)
+		flt_big_multiply(pb, k5u[6]);
+	if (base_5_exponent > 0)
+		flt_big_multiply(pb, k5u[base_5_exponent]);
+	if (base_2_exponent > 0) {
+		/* Whole words, then the remaining bits */
+		i = base_2_exponent >> 4;
+		memmove(pb->w + i, pb->w, pb->n * sizeof(uint16_t));
+		memset(pb->w, 0, i * sizeof(uint16_t));
+		pb->n += i;
+		if (base_2_exponent & 0xF)
+			flt_big_multiply(pb, 1U << (base_2_exponent & 0xF));
+	}
 }
 
-/* Convenience function to post-process depending on format and precision */
-static char *printf_post_process(char *string, const char *format, const int precision) {
-	char *decimal_marker, *exponent_marker, *c;
+/* Convenience function to add c to b */
+static void flt_big_add(flt_big *pb, const flt_big *pc) {
+	uint32_t carry;
 	int i;
-	/* Decimal marker processing */
-	if (decimal_marker = strchr(string, '.')) {
-		/* Remove the decimal marker if precision is zero */
-		if (!precision)
-			memmove(decimal_marker, decimal_marker + 1, strlen(decimal_marker + 1) + 1);
-		/* Remove trailing zeroes for g format */
-		else if (strchr(format, 'G') || strchr(format, 'g')) {
-			if (exponent_marker = strchr(string, 'e')) {
-				for (c = exponent_marker - 1; c > string ; --c) {
-					if (*c == '.')
-						break;
-					else if (*c != '0') {
-						++c;
-						break;
-					}
-				}
-				if (c < exponent_marker)
-					memmove(c, exponent_marker, strlen(exponent_marker) + 1);
-			} else {
-				for (i = strlen(string) - 1; i > 0; --i)
-					if (string[i] == '0')
-						string[i] = '\0';
-					else if (string[i] == '.') {
-						string[i] = '\0';
-						break;
-					}
-					else
-						break;
-			}
-		}
+	if (pb->n < pc->n)
+		pb->n = pc->n;
+	for (carry = 0, i = 0; i < pb->n; ++i) {
+		carry += (uint32_t)pb->w[i] + pc->w[i];
+		pb->w[i] = (uint16_t)carry;
+		carry >>= 16;
 	}
-	/* Strip leading plus if required */
-	if (!strchr(format, '+') && string[0] == '+')
-		memmove(string, string + 1, strlen(string + 1) + 1);
-	/* Convert to uppercase if required */
-	if (strchr(format, 'E') || strchr(format, 'F') || strchr(format, 'G')) {
-		for (i = 0; string[i]; ++i)
-			string[i] = toupper(string[i]);
+	if (carry)
+		pb->w[pb->n++] = (uint16_t)carry;
+}
+
+/* Convenience function to subtract c from b, b has to be at least c */
+static void flt_big_subtract(flt_big *pb, const flt_big *pc) {
+	uint32_t borrow;
+	int i;
+	for (borrow = 0, i = 0; i < pb->n; ++i) {
+		borrow = (uint32_t)pb->w[i] - pc->w[i] - borrow;
+		pb->w[i] = (uint16_t)borrow;
+		borrow = (borrow >> 16) & 1;
 	}
-	/* Done */
-	return string;
+	while (pb->n && !pb->w[pb->n - 1])
+		--pb->n;
+}
+
+/* Convenience function to compare b with c, returns -1, 0, or 1 like memcmp */
+static int flt_big_compare(const flt_big *pb, const flt_big *pc) {
+	int i;
+	if (pb->n != pc->n)
+		return (pb->n < pc->n)? -1: 1;
+	for (i = pb->n - 1; i >= 0; --i)
+		if (pb->w[i] != pc->w[i])
+			return (pb->w[i] < pc->w[i])? -1: 1;
+	return 0;
 }
 
 char *flt_get_scanf_buffer(int offset) {
@@ -519,55 +1047,3 @@ char *flt_get_scanf_buffer(int offset) {
 		strcpy(_strings + index, "nan");
 	return _strings + index;
 }
-
-static void flt_tmp_prepare_constants() {
-	static bool _prepared = false;
-	FLT f;
-	if (!_prepared) {
-		/* Fibonacci 1, 2, 3, 5 */
-		f = flt_ltof(1);
-		flt_to_tmp(&f, &k1);
-		f = flt_ltof(2);
-		flt_to_tmp(&f, &k2);
-		f = flt_ltof(3);
-		flt_to_tmp(&f, &k3);
-		f = flt_ltof(5);
-		flt_to_tmp(&f, &k5);
-		/* As above negated */
-		flt_tmp_copy(&kn1, &k1);
-		flt_tmp_negate(&kn1);
-		flt_tmp_copy(&kn2, &k2);
-		flt_tmp_negate(&kn2);
-		flt_tmp_copy(&kn3, &k3);
-		flt_tmp_negate(&kn3);
-		flt_tmp_copy(&kn5, &k5);
-		flt_tmp_negate(&kn5);
-		/* 10, 100, 1e3, 1e5, 1e8 */
-		f = flt_ltof(10);
-		flt_to_tmp(&f, &k10);
-		f = flt_ltof(100);
-		flt_to_tmp(&f, &k100);
-		f = flt_ltof(1000);
-		flt_to_tmp(&f, &k1e3);
-		f = flt_ltof(100000);
-		flt_to_tmp(&f, &k1e5);
-		f = flt_ltof(100000000);
-		flt_to_tmp(&f, &k1e8);
-		/* As above inverted */
-		flt_tmp_copy(&k1en1, &k10);
-		flt_tmp_invert(&k1en1);
-		flt_tmp_copy(&k1en2, &k100);
-		flt_tmp_invert(&k1en2);
-		flt_tmp_copy(&k1en3, &k1e3);
-		flt_tmp_invert(&k1en3);
-		flt_tmp_copy(&k1en5, &k1e5);
-		flt_tmp_invert(&k1en5);
-		flt_tmp_copy(&k1en8, &k1e8);
-		flt_tmp_invert(&k1en8);
-		/* One half */
-		flt_tmp_copy(&k5en1, &k2);
-		flt_tmp_invert(&k5en1);
-		/* Done */
-		_prepared = true;
-	}
-}
@@ -5,12 +5,44 @@
 */
 #include "flt-tmp.h"
 
+/* Enough to take any finite non-zero value to infinity or zero */
+#define	LDEXP_LIMIT	(2 * (FLT_E_BIAS) + (FLT_M_BITS) + 2)
+
 FLT flt_ldexp(const FLT f, const int exponent) {
-	FLT result;
-	flt_tmp t;
-	flt_to_tmp(&f, &t);
-	if (t.c == E_NORMAL)
-		t.e += exponent;
-	tmp_to_flt(&t, &result);
-	return result;
+	uint32_t sign, mantissa, remainder, half;
+	int working, shift;
+	sign = f & FLT_S_MASK;
+	working = flt_exponent(f);
+	mantissa = f & FLT_M_MASK;
+	/* Infinity and NaN are unchanged */
+	if (working > FLT_E_BIAS)
+		return mantissa? FLT_NAN: f;
+	if (working < 1 - FLT_E_BIAS) {
+		/* Zero is unchanged */
+		if (!mantissa)
+			return f;
+		/* Subnormal, shift up to normalize */
+		for (working = 1 - FLT_E_BIAS; !(mantissa & (FLT_M_MASK + 1)); --working)
+			mantissa <<= 1;
+	} else
+		mantissa |= FLT_M_MASK + 1;
+	/* Adjust the exponent, clamping to avoid integer overflow */
+	working += (exponent > LDEXP_LIMIT)? LDEXP_LIMIT: (exponent < -LDEXP_LIMIT)? -LDEXP_LIMIT: exponent;
+	/* Infinity */
+	if (working > FLT_E_BIAS)
+		return sign | FLT_POS_INF;
+	/* Normal, the implicit bit adds one to the exponent */
+	if (working >= 1 - FLT_E_BIAS)
+		return sign + ((uint32_t)(working + FLT_E_BIAS - 1) << FLT_M_BITS) + mantissa;
+	/* Subnormal or zero, Banker's rounding using the bits shifted out */
+	shift = 1 - FLT_E_BIAS - working;
+	if (shift > FLT_M_BITS + 1)
+		return sign;
+	remainder = mantissa & ((1UL << shift) - 1);
+	half = 1UL << (shift - 1);
+	mantissa >>= shift;
+	if (remainder > half || (remainder == half && (mantissa & 1)))
+		++mantissa;
+	/* Rounding up to the smallest normal rolls into the exponent */
+	return sign | mantissa;
 }
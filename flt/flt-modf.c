@@ -23,21 +23,23 @@ FLT flt_modf(const FLT f, FLT *pg) {
 	return result;
 }
 
-/* Note not static because also used by pow, fmod, ceil, and floor */
+/* Note not static because also used by pow and trig */
 void flt_tmp_modf(flt_tmp *pt, flt_tmp *pu) {
+	uint32_t mask;
 	int sign;
-	flt_tmp v;
 	sign = pt->s;
 	pt->s = 0;
-	if (pt->e <= TMP_1_BITS) {
+	if (pt->c != E_NORMAL || pt->e < 0)
+		/* No integer part */
 		flt_tmp_init_0(pu);
-		while (pt->c == E_NORMAL && pt->e >= 0) {
-			flt_tmp_initialize(&v, E_NORMAL, 0, TMP_1, pt->e);
-			flt_tmp_add(pu, &v);
-			flt_tmp_negate(&v);
-			flt_tmp_add(pt, &v);
-		}
+	else if (pt->e < TMP_1_BITS) {
+		/* Mask separates the integer and fraction bits of the mantissa */
+		mask = ~0UL << (TMP_1_BITS - pt->e);
+		flt_tmp_initialize(pu, E_NORMAL, 0, pt->m & mask, pt->e);
+		pt->m &= ~mask;
+		flt_tmp_normalize(pt);
 	} else {
+		/* No fraction part */
 		flt_tmp_copy(pu, pt);
 		flt_tmp_init_0(pt);
 	}
@@ -179,20 +179,8 @@ static void flt_tmp_powN(flt_tmp *pt, flt_tmp *pu) {
 }
 
 static bool flt_tmp_is_odd(const flt_tmp *pt) {
-	bool result = false;
-	flt_tmp u, v;
-	flt_tmp_copy(&u, pt);
-	if (u.c == E_NORMAL) {
-		u.s = 0;
-		/* Remove any existing decimals */
-		flt_tmp_modf(&u, &v);
-		/* Check if v/2 has a remainder */
-		if (v.e >= 0) {
-			v.e -= 1;	/* v/2 */
-			flt_tmp_modf(&v, &u);
-			/* Remainder means odd */
-			result = (v.c == E_NORMAL);
-		}
-	}
-	return result;
+	/* Check the units bit of the mantissa, any fraction bits below it are ignored */
+	if (pt->c == E_NORMAL && pt->e >= 0 && pt->e <= TMP_1_BITS)
+		return (pt->m >> (TMP_1_BITS - pt->e)) & 1;
+	return false;
 }
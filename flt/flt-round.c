@@ -5,85 +5,77 @@
 */
 #include "flt-tmp.h"
 
-static void flt_tmp_ceil(flt_tmp *pt);
-static void flt_tmp_floor(flt_tmp *pt);
+/* All of these work directly on the packed IEEE 754 bits using a mask derived from the exponent */
 
 FLT flt_round(const FLT f) {
-	FLT result;
-	flt_tmp t, u;
-	flt_to_tmp(&f, &t);
-	if (t.c == E_NORMAL) {
-		flt_tmp_initialize(&u, E_NORMAL, t.s, TMP_1, -1); /* +/- 0.5 */
-		flt_tmp_add(&t, &u);
-		flt_tmp_modf(&t, &u);
-		tmp_to_flt(&u, &result);
-	} else
-		result = f;
-	return result;
+	uint32_t mask;
+	int exponent = flt_exponent(f);
+	/* Already an integer, or infinity or NaN */
+	if (exponent >= FLT_M_BITS)
+		return f;
+	/* |f| < 0.5 rounds to zero, 0.5 <= |f| < 1 rounds away from zero to one */
+	if (exponent < 0)
+		return (f & FLT_S_MASK) | (exponent == -1? FLT_POS_1: FLT_POS_0);
+	mask = FLT_M_MASK >> exponent;
+	if (!(f & mask))
+		return f;
+	/* Add one half, any carry rolls into the exponent, then clear the fraction */
+	return (f + ((mask + 1) >> 1)) & ~mask;
 }
 
 FLT flt_trunc(const FLT f) {
-	FLT result;
-	flt_tmp t, u;
-	flt_to_tmp(&f, &t);
-	if (t.c == E_NORMAL) {
-		flt_tmp_modf(&t, &u);
-		tmp_to_flt(&u, &result);
-	} else
-		result = f;
-	return result;
+	int exponent = flt_exponent(f);
+	/* Already an integer, or infinity or NaN */
+	if (exponent >= FLT_M_BITS)
+		return f;
+	/* |f| < 1 truncates to zero */
+	if (exponent < 0)
+		return f & FLT_S_MASK;
+	return f & ~(FLT_M_MASK >> exponent);
 }
 
 FLT flt_ceil(const FLT f) {
 	FLT result;
-	flt_tmp t;
-	int sign;
-	flt_to_tmp(&f, &t);
-	if (t.c == E_NORMAL) {
-		sign = t.s;
-		t.s = 0;
-		if (sign)
-			flt_tmp_floor(&t);
-		else
-			flt_tmp_ceil(&t);
-		t.s = sign;
-		tmp_to_flt(&t, &result);
-	} else
-		result = f;
-	return result;
+	uint32_t mask;
+	int exponent = flt_exponent(f);
+	/* Already an integer, or infinity or NaN */
+	if (exponent >= FLT_M_BITS)
+		return f;
+	/* |f| < 1 goes to -0 if negative, or +1 if positive and non-zero */
+	if (exponent < 0) {
+		if (f & FLT_S_MASK)
+			return FLT_NEG_0;
+		return f? FLT_POS_1: f;
+	}
+	mask = FLT_M_MASK >> exponent;
+	if (!(f & mask))
+		return f;
+	/* Away from zero for positive numbers, any carry rolls into the exponent */
+	result = f;
+	if (!(f & FLT_S_MASK))
+		result += mask + 1;
+	return result & ~mask;
 }
 
 FLT flt_floor(const FLT f) {
 	FLT result;
-	flt_tmp t;
-	int sign;
-	flt_to_tmp(&f, &t);
-	if (t.c == E_NORMAL) {
-		sign = t.s;
-		t.s = 0;
-		if (sign)
-			flt_tmp_ceil(&t);
-		else
-			flt_tmp_floor(&t);
-		t.s = sign;
-		tmp_to_flt(&t, &result);
-	} else
-		result = f;
-	return result;
-}
-
-static void flt_tmp_ceil(flt_tmp *pt) {
-	flt_tmp u;
-	flt_tmp_copy(&u, pt);
-	flt_tmp_modf(&u, pt);
-	if (u.c == E_NORMAL) {
-		flt_tmp_init_1(&u);
-		flt_tmp_add(pt, &u);
+	uint32_t mask;
+	int exponent = flt_exponent(f);
+	/* Already an integer, or infinity or NaN */
+	if (exponent >= FLT_M_BITS)
+		return f;
+	/* |f| < 1 goes to +0 if positive, or -1 if negative and non-zero */
+	if (exponent < 0) {
+		if (!(f & FLT_S_MASK))
+			return FLT_POS_0;
+		return (f & ~FLT_S_MASK)? FLT_NEG_1: f;
 	}
-}
-
-static void flt_tmp_floor(flt_tmp *pt) {
-	flt_tmp u;
-	flt_tmp_copy(&u, pt);
-	flt_tmp_modf(&u, pt);
+	mask = FLT_M_MASK >> exponent;
+	if (!(f & mask))
+		return f;
+	/* Away from zero for negative numbers, any carry rolls into the exponent */
+	result = f;
+	if (f & FLT_S_MASK)
+		result += mask + 1;
+	return result & ~mask;
 }
@@ -11,8 +11,8 @@
 #include "flt.h"
 
 /* Internal structure with 7 bits more precision in the mantissa (vs. IEEE 754
- * single-precision) to use for calculations */
-typedef struct {E_CLASS c; int s, e; uint32_t m;} flt_tmp;
+ * single-precision) to use for calculations, also public as FLT_EXT */
+typedef FLT_EXT flt_tmp;
 
 /* Useful macros for flt_tmp */
 #define	TMP_1_BITS	(30)
@@ -22,6 +22,14 @@ typedef struct {E_CLASS c; int s, e; uint32_t m;} flt_tmp;
 #define	TMP_U_SHFT	(16)
 #define	TMP_L_MASK	(0xFFFF)
 
+/* Useful macros to access the fields of the packed IEEE 754 representation */
+#define	FLT_M_BITS	(23)
+#define	FLT_M_MASK	(0x7FFFFFL)
+#define	FLT_E_MASK	(0xFF)
+#define	FLT_E_BIAS	(127)
+#define	FLT_S_MASK	(0x80000000UL)
+#define	flt_exponent(f)	((int)(((f) >> (FLT_M_BITS)) & (FLT_E_MASK)) - (FLT_E_BIAS))
+
 /* Frequently used mantissas */
 #define	TMP_PI_2	(0x6487ED51)	/* PI/2 = 1.5707963267949 */
 #define	TMP_2LOG2	(0x58B90BFC)	/* 2*log(2) = 1.38629436111989 */
@@ -45,6 +53,7 @@ void flt_tmp_add(flt_tmp *pt, const flt_tmp *pu);
 void flt_tmp_multiply(flt_tmp *pt, const flt_tmp *pu);
 void flt_tmp_negate(flt_tmp *pt);
 void flt_tmp_invert(flt_tmp *pt);
+void flt_tmp_divide(flt_tmp *pt, const flt_tmp *pu);
 void flt_tmp_evaluate(flt_tmp *pt, const int limit, const int *ps, const uint32_t *pm, const int *pe);
 void flt_tmp_sqrt(flt_tmp *pt);
 void flt_tmp_sqrt_ext(flt_tmp *pt);
@@ -7,7 +7,9 @@
 #define	_FLT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /* IEEE 754 single-precision with 1 sign bit, 8 exponent bits, and 24 significand precision bits (23 explicitly stored) */
 #ifndef	_FLT_TDF
@@ -26,6 +28,17 @@ typedef uint32_t FLT;
 #define	FLT_POS_PI_2	(0x3FC90FDB)	/* +PI/2 */
 #define	FLT_NEG_PI_2	(0xBFC90FDB)	/* -PI/2 */
 
+/* Packed format specifications for flt_ftoa_fmt*, e.g. "%+.3E" is FLT_FMT_E | FLT_FMT_UPPER | FLT_FMT_PLUS | 3 */
+#define	FLT_FMT_PRECISION	(0x000F)	/* Digits after the decimal marker, up to 9 */
+#define	FLT_FMT_E		(0x0010)
+#define	FLT_FMT_F		(0x0020)
+#define	FLT_FMT_G		(0x0030)
+#define	FLT_FMT_R		(0x0040)
+#define	FLT_FMT_A		(0x0050)	/* Hexadecimal, always exact */
+#define	FLT_FMT_STYLE		(0x0070)
+#define	FLT_FMT_UPPER		(0x0100)
+#define	FLT_FMT_PLUS		(0x0200)
+
 /* (Possibly) redefined "float.h" constants */
 #undef	FLT_MIN
 #define	FLT_MIN		(1.17549435082e-38)
@@ -40,15 +53,34 @@ typedef uint32_t FLT;
 typedef enum {E_INFINITE = 1, E_NAN, E_NORMAL, E_SUBNORMAL, E_ZERO} E_CLASS;
 typedef enum {E_EQUAL_TO = 1, E_LESS_THAN, E_GREATER_THAN, E_LESS_THAN_OR_EQUAL_TO, E_GREATER_THAN_OR_EQUAL_TO, E_NOT_EQUAL_TO} E_COMPARE;
 
+/* Unpacked value with 7 bits more precision in the mantissa, for evaluating an expression with flt_ext_* so that only the
+ * result is rounded to FLT */
+typedef struct {E_CLASS c; int s, e; uint32_t m;} FLT_EXT;
+
+/* Inline forms working directly on the bits, the arguments are evaluated once except in FLT_FSGN */
+#define	FLT_NEGATED(f)		((FLT)((f) ^ 0x80000000UL))
+#define	FLT_FABS(f)		((FLT)((f) & 0x7FFFFFFFUL))
+#define	FLT_COPYSIGN(f, g)	((FLT)(((f) & 0x7FFFFFFFUL) | ((g) & 0x80000000UL)))
+#define	FLT_ISINF(f)		(((f) & 0x7FFFFFFFUL) == 0x7F800000UL)
+#define	FLT_ISNAN(f)		(((f) & 0x7FFFFFFFUL) > 0x7F800000UL)
+#define	FLT_ISZERO(f)		(!((f) & 0x7FFFFFFFUL))
+#define	FLT_LESS_THAN_0(f)	((FLT)((f) - 0x80000001UL) < 0x7F800000UL)	/* -0 and NaN are not less than zero */
+#define	FLT_GREATER_THAN_0(f)	((FLT)((f) - 0x00000001UL) < 0x7F800000UL)
+#define	FLT_FSGN(f)		((int)FLT_GREATER_THAN_0(f) - (int)FLT_LESS_THAN_0(f))
+
 /* Used in *scanf, defined in flt_io.c */
+#define	FLT_SCANF_VALUES	(10)	/* Most FLT parameters in one sscanf call converted to flt_parse_array */
 extern int g_flt_last_scanf_result;
+extern FLT g_flt_scanf_values[FLT_SCANF_VALUES];
 
 FLT flt_ldexp(const FLT f, const int exponent);
 FLT flt_frexp(const FLT f, int *exponent);
 FLT flt_modf(const FLT f, FLT *pg);
 FLT flt_fmod(const FLT f, const FLT g);
+FLT flt_remquo(const FLT f, const FLT g, int *quotient);
 
 FLT flt_fabs(const FLT f);
+FLT flt_copysign(const FLT f, const FLT g);
 FLT flt_round(const FLT f);
 FLT flt_trunc(const FLT f);
 FLT flt_ceil(const FLT f);
@@ -104,13 +136,44 @@ FLT flt_post_increment(FLT *pf);
 FLT flt_pre_decrement(FLT *pf);
 FLT flt_post_decrement(FLT *pf);
 
+void flt_ext_load(FLT_EXT *px, const FLT f);
+FLT flt_ext_store(const FLT_EXT *px);
+void flt_ext_add(FLT_EXT *px, const FLT_EXT *py);
+void flt_ext_subtract(FLT_EXT *px, const FLT_EXT *py);
+void flt_ext_multiply(FLT_EXT *px, const FLT_EXT *py);
+void flt_ext_divide(FLT_EXT *px, const FLT_EXT *py);
+void flt_ext_add_f(FLT_EXT *px, const FLT g);
+void flt_ext_subtract_f(FLT_EXT *px, const FLT g);
+void flt_ext_multiply_f(FLT_EXT *px, const FLT g);
+void flt_ext_divide_f(FLT_EXT *px, const FLT g);
+
 FLT flt_atof(const char *string);
+FLT flt_strtof(const char *string, char **end);
+int flt_parse_array(const char *string, FLT *values, const int count);
+#ifndef	FLT_NO_RING_BUFFERS
 const char *flt_ftoa(const FLT f, const char *format);
+const char *flt_ftoa_fmt(const FLT f, const unsigned spec);
+const char *flt_ftoa_shortest(const FLT f);
+#endif	/* FLT_NO_RING_BUFFERS */
+size_t flt_ftoa_r(const FLT f, const char *format, char *buffer, const size_t length);
+size_t flt_ftoa_fmt_r(const FLT f, const unsigned spec, char *buffer, const size_t length);
+int flt_fputf(FILE *stream, const FLT f, const char *format);
+size_t flt_emit(const FLT f, const char *format, void (*put_char)(char));
 char *flt_get_scanf_buffer(int offset);
 FLT flt_ltof(const int32_t a);
 FLT flt_ultof(const uint32_t a);
 int32_t flt_ftol(const FLT f);
 uint32_t flt_ftoul(const FLT f);
+FLT flt_itof16(const int16_t a);
+FLT flt_uitof16(const uint16_t a);
+FLT flt_uctof(const unsigned char a);
+int16_t flt_ftoi16(const FLT f);
+uint16_t flt_ftoui16(const FLT f);
+unsigned char flt_ftouc(const FLT f);
+FLT flt_itof(const int a);
+FLT flt_uitof(const unsigned a);
+int flt_ftoi(const FLT f);
+unsigned flt_ftoui(const FLT f);
 
 FLT flt_fmin(const FLT f, const FLT g);
 FLT flt_fmax(const FLT f, const FLT g);
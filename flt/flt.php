@@ -4,16 +4,22 @@
   Repository: https://github.com/Russell-S-Harper/FLT
      Contact: russell.s.harper@gmail.com
 */
-// Usage: php flt.php [-d] [-i input-file] [-o output-file] [-x extra-gcc-options]
+// Usage: php flt.php [-b] [-d] [-e] [-O fast] [-i input-file] [-o output-file] [-x extra-gcc-options]
+//        php flt.php [-b] [-d] [-e] [-O fast] [-j jobs] [-x extra-gcc-options] input-file ...
 
 define('FLT_VERSION', '1.0');	// Initial release
 
 define('FLT_TYPE_REGEX', 'FLT');
 
+define('FLT_SCANF_VALUES', 10);	// Same as in flt.h
+
+define('FLT_CACHE_DIR', '.flt-cache');	// Translations of unchanged files are reused from here
+
 define('INT_TYPE_REGEX', '(?:(?:unsigned|signed|char|short|int|long|size_t|u?int[0-9]+_t)\s*)+');
 
 define('FLT_LITERAL_REGEX',
-	'\b[0-9]+\.[0-9]+[Ee][-+]?[0-9]+[FfLl]?'
+	'\b0[Xx](?:[0-9A-Fa-f]+\.?[0-9A-Fa-f]*|\.[0-9A-Fa-f]+)[Pp][-+]?[0-9]+[FfLl]?'
+	.'|\b[0-9]+\.[0-9]+[Ee][-+]?[0-9]+[FfLl]?'
 	.'|\b[0-9]+\.[Ee][-+]?[0-9]+[FfLl]?'
 	.'|\b\.[0-9]+[Ee][-+]?[0-9]+[FfLl]?'
 	.'|\b[0-9]+[Ee][-+]?[0-9]+[FfLl]?'
@@ -27,34 +33,48 @@ main($argc, $argv);
 function main($argc, $argv) {
 	// Retrieve the parameters
 	$params = get_parameters($argc, $argv);
-	// To keep track of how many passes
+	// Several files are translated by separate processes
+	if ($params['files'])
+		exit(translate_files($params));
+	// To keep track of how many passes and how long they took
 	$pass = 0;
+	$time = microtime(true);
 	// Get the code
 	$code = file_get_contents($params['-i']);
+	$count = substr_count($code, "\n");
 	// Preprocess to convert to FLT and clean up a bit
-	$lines = preprocess($code, $pass, $params['-x']);
+	$lines = preprocess($code, $pass, $params['-x'], $params['-d']);
+	$preprocess_time = microtime(true) - $time;
 	// To keep track of any substitutions for postprocessing
 	$substitutions = array();
 	// Attempt a compile and process the errors until done
 	do
-		$done = compile($lines, $substitutions, ++$pass, $params['-d']);
+		$done = compile($lines, $substitutions, ++$pass, $params['-d'], false, $params['-b']);
 	while (!$done && $pass < 50);
 	// Final passes to set global and static initializers
 	if ($done) {
 		do
-			$done = compile($lines, $substitutions, ++$pass, $params['-d'], true);
+			$done = compile($lines, $substitutions, ++$pass, $params['-d'], true, $params['-b']);
 		while (!$done && $pass < 50);
 	}
 	if ($done) {
 		// Postprocess to restore substitutions and convert assignments to literals
-		$code = postprocess($lines, $substitutions);
+		$code = postprocess($lines, $substitutions, $params['-e'], $params['-O'] == 'fast', $params['-d']);
 		file_put_contents($params['-o'], $code);
-		array_map('unlink', glob('__FLT_TMP_*'));
 	} else
 		file_put_contents('php://stderr', '*** ERROR: conversion failure ***'.PHP_EOL.
 			'Ensure the input has no errors or warnings when compiled normally.'.PHP_EOL.
 			'Rerun with debug enabled "-d" and review STDERR output.'.PHP_EOL.
-			'Also review the generated __FLT_TMP_* files for more information.'.PHP_EOL, FILE_APPEND);
+			'Also review the files kept in the workspace with "-d" for more information.'.PHP_EOL, FILE_APPEND);
+	if ($params['-d']) {
+		file_put_contents('php://stderr', basename(__FILE__).': workspace is '.get_workspace().PHP_EOL, FILE_APPEND);
+		// Report the throughput, in lines of input per second
+		$time = microtime(true) - $time;
+		file_put_contents('php://stderr', basename(__FILE__).': '.$params['-i'].': '.$count.' lines, preprocess '
+			.sprintf('%.2f s (%.0f lines/s)', $preprocess_time, $count / max($preprocess_time, 1e-6)).', '.$pass.' pass'.($pass == 1? '': 'es')
+			.sprintf(' in %.2f s (%.0f lines/s)', $time, $count / max($time, 1e-6)).PHP_EOL, FILE_APPEND);
+	} else
+		@rmdir(get_workspace());
 	// Done
 	exit($done? 0: 1);
 }
@@ -62,33 +82,57 @@ function main($argc, $argv) {
 // Converts the $argc, $argv values to an associative array for easier lookup, typically expects key/value pairs as '-<character> <argument>'
 function get_parameters($argc, $argv) {
 	$params = array(
+		'-b' => 0,
 		'-d' => 0,
+		'-e' => 0,
 		'-i' => 'php://stdin',
+		'-j' => 1,
 		'-o' => 'php://stdout',
-		'-x' => ''
+		'-O' => '',
+		'-x' => '',
+		'files' => array()
 	);
 	for ($i = 1; $i < $argc; ++$i) {
 		$working = $argv[$i];
 		if (strlen($working) == 2 && $working[0] == '-') {
 			// Options not requiring an argument
-			if (in_array($working, array('-d', '-D')))
+			if (in_array($working, array('-b', '-B', '-d', '-D', '-e', '-E')))
 				$params[strtolower($working)] = 1;
 			// Options requiring an argument
-			else if (in_array($working, array('-i', '-I', '-o', '-O', '-x', '-X')))
+			else if (in_array($working, array('-i', '-I', '-j', '-J', '-o', '-x', '-X')))
 				if ($i + 1 < $argc)
 					$params[strtolower($working)] = $argv[++$i];
 				else
 					file_put_contents('php://stderr', 'Warning: option "'.$working.'" requires an argument!'.PHP_EOL);
+			// Optimization level with "fast", otherwise the output the same as -o
+			else if ($working == '-O')
+				if ($i + 1 >= $argc)
+					file_put_contents('php://stderr', 'Warning: option "-O" requires an argument!'.PHP_EOL);
+				else if ($argv[$i + 1] == 'fast')
+					$params['-O'] = $argv[++$i];
+				else
+					$params['-o'] = $argv[++$i];
 			else {
 				$base = basename(__FILE__);
 				file_put_contents('php://stdout', $base.' v'.FLT_VERSION.' -- convert C code to use FLT and flt_* vs. float/double'.PHP_EOL.
 					PHP_EOL.
-					'Usage: php '.$base.' -h | [-d] [-i input] [-o output] [-x extra-gcc-options]'.PHP_EOL.
+					'Usage: php '.$base.' -h | [-b] [-d] [-e] [-O fast] [-i input] [-o output] [-x extra-gcc-options]'.PHP_EOL.
+					'       php '.$base.' [-b] [-d] [-e] [-O fast] [-j jobs] [-x extra-gcc-options] input ...'.PHP_EOL.
 					"  -h\t\toutput this message to php://stdout and exit".PHP_EOL.
-					"  -d\t\toutput debug info to php://stderr".PHP_EOL.
+					"  -b\t\tformat FLT *printf parameters into buffers on the stack where possible".PHP_EOL.
+					"  -e\t\tevaluate FLT expressions with the flt_ext_* expression kernel, rounding".PHP_EOL.
+					"\t\tonly the result".PHP_EOL.
+					"  -d\t\toutput debug info to php://stderr and keep the intermediate files".PHP_EOL.
 					"  -i FILE\tinput file/stream, default is php://stdin".PHP_EOL.
+					"  -j JOBS\thow many input files to translate at once, default is 1".PHP_EOL.
 					"  -o FILE\toutput file/stream, default is php://stdout".PHP_EOL.
+					"  -O fast\tallow transformations that aren't exact under IEEE 754: dividing by".PHP_EOL.
+					"\t\ta constant or a loop invariant multiplies by its reciprocal, constants".PHP_EOL.
+					"\t\tare reassociated, and comparisons ignore NaN".PHP_EOL.
+					"  -O FILE\tsame as -o FILE for any FILE other than fast".PHP_EOL.
 					"  -x OPTIONS\textra options to pass to gcc".PHP_EOL.
+					"  input ...\tinput files, each X.c is translated to X-flt.c, reusing earlier".PHP_EOL.
+					"\t\ttranslations from ".FLT_CACHE_DIR." if nothing has changed".PHP_EOL.
 					PHP_EOL.
 					"Requirements:".PHP_EOL.
 					"  - gcc v9.0 or later (v9.0+); uses the '-fdiagnostics-format=json' option".PHP_EOL.
@@ -122,7 +166,8 @@ function get_parameters($argc, $argv) {
 					"  - I/O functions are limited in how many float parameters can be specified in".PHP_EOL.
 					"    a single function call. For *printf, up to 15 \"%e\"/\"%E\" & five \"%f\"/\"%F\"".PHP_EOL.
 					"    parameters, and for *scanf, up to five parameters of any format can be".PHP_EOL.
-					"    specified.".PHP_EOL.
+					"    specified. With \"-b\", a *printf call that is a statement on its own line".PHP_EOL.
+					"    has no limit as each parameter gets its own buffer on the stack.".PHP_EOL.
 					"  - Some expressions involving *scanf may behave differently in FLT. In".PHP_EOL.
 					"    particular, constructions like:".PHP_EOL.
 					"        if (1 == scanf(\"%10f\", &f)) { ... }".PHP_EOL.
@@ -134,7 +179,10 @@ function get_parameters($argc, $argv) {
 					"    criteria with respect to what is valid or not. So a call like:".PHP_EOL.
 					"        sscanf(\"X Y Z\", \"%f %f %f\", ...);".PHP_EOL.
 					"    may return 3 indicating three \"matches\". A workaround is to use !isnan()".PHP_EOL.
-					"    on each variable to confirm if it is valid.".PHP_EOL.
+					"    on each variable to confirm if it is valid. The exception is a sscanf with".PHP_EOL.
+					"    only FLT parameters without widths, separated by nothing but whitespace,".PHP_EOL.
+					"    e.g. \"%f %f %f\", which is converted to flt_parse_array, so parsing stops at".PHP_EOL.
+					"    the first invalid value.".PHP_EOL.
 					"  - Similar to above, FLT parameters in *printf are also handled as strings, so".PHP_EOL.
 					"    padding is restricted to spaces for FLT values.".PHP_EOL.
 					"  - The variadic functions vprintf, vscanf, and related are not supported.".PHP_EOL.
@@ -144,20 +192,157 @@ function get_parameters($argc, $argv) {
 					PHP_EOL.
 					"Examples:".PHP_EOL.
 					"  php flt.php -i eg/paranoia.c -o eg/paranoia-flt.c -x '-DNOSIGNAL -DSingle'".PHP_EOL.
-					"  php flt.php -i eg/averages.c -o eg/averages-flt.c -x '-I cc65/include'".PHP_EOL, FILE_APPEND);
+					"  php flt.php -i eg/averages.c -o eg/averages-flt.c -x '-I cc65/include'".PHP_EOL.
+					"  php flt.php -j 4 eg/averages.c eg/flops.c eg/mandelfloat.c".PHP_EOL, FILE_APPEND);
 				exit(1);
 			}
 		} else
-			file_put_contents('php://stderr', 'Warning: input "'.$working.'" ignored!'.PHP_EOL);
+			$params['files'][] = $working;
 	}
+	$params['-j'] = max(intval($params['-j']), 1);
 	// Done
 	return $params;
 }
 
-function preprocess($code, $pass, $extra) {
+// Translates each X.c to X-flt.c running up to -j translations at once, returns the exit code
+function translate_files($params) {
+	// Everything else that affects the output, along with the preprocessed input, makes up the cache key. The preprocessed
+	// input has flt.h, flt-parse.h, and the headers the input includes itself, so a change to any of them is a new key.
+	$key = FLT_VERSION.sha1_file(__FILE__).$params['-b'].$params['-e'].$params['-O'].$params['-x'].shell_exec('gcc -dumpfullversion -dumpversion');
+	$options = ($params['-b']? ' -b': '').($params['-d']? ' -d': '').($params['-e']? ' -e': '').($params['-O']? ' -O '.$params['-O']: '').' -x '.escapeshellarg($params['-x']);
+	$pending = $params['files'];
+	$running = array();
+	$failures = 0;
+	while ($pending || $running) {
+		// Start as many translations as allowed
+		while ($pending && count($running) < $params['-j']) {
+			$input = array_shift($pending);
+			$output = preg_replace('/(?:\.c)?$/', '-flt.c', $input, 1);
+			if (!is_readable($input)) {
+				file_put_contents('php://stderr', 'Warning: input "'.$input.'" not found!'.PHP_EOL, FILE_APPEND);
+				++$failures;
+				continue;
+			}
+			// Not cached if it doesn't preprocess, the translation will report why
+			$code = shell_exec('gcc '.get_preprocess_options($params['-x']).' '.escapeshellarg($input).' 2> /dev/null');
+			$cache = strlen($code)? FLT_CACHE_DIR.'/'.sha1($key.$code).'.c': null;
+			if ($cache && file_exists($cache) && copy_atomically($cache, $output)) {
+				file_put_contents('php://stderr', basename(__FILE__).': '.$input.': unchanged'.PHP_EOL, FILE_APPEND);
+				continue;
+			}
+			$process = proc_open(escapeshellarg(PHP_BINARY).' '.escapeshellarg(__FILE__).$options
+				.' -i '.escapeshellarg($input).' -o '.escapeshellarg($output), array(0 => STDIN, 1 => STDOUT, 2 => STDERR), $pipes);
+			if (is_resource($process))
+				$running[] = array($process, $output, $cache);
+			else
+				++$failures;
+		}
+		// Collect any finished translations, caching the successful ones
+		foreach ($running as $index => list($process, $output, $cache)) {
+			$status = proc_get_status($process);
+			if (!$status['running']) {
+				proc_close($process);
+				if ($status['exitcode'] == 0) {
+					if ($cache) {
+						@mkdir(FLT_CACHE_DIR);
+						copy_atomically($output, $cache);
+					}
+				} else
+					++$failures;
+				unset($running[$index]);
+			}
+		}
+		if ($running)
+			usleep(10000);
+	}
+	return $failures? 1: 0;
+}
+
+// Copies to a temporary name next to $to and renames it, so a run reading $to at the same time never sees it partly written
+function copy_atomically($from, $to) {
+	$temporary = $to.'.'.getmypid().'.tmp';
+	if (copy($from, $temporary) && rename($temporary, $to))
+		return true;
+	@unlink($temporary);
+	return false;
+}
+
+// Returns the path of a header kept with this script, wherever it's run from, stopping if it's missing
+function get_header($name) {
+	$path = __DIR__.'/'.$name;
+	if (!is_readable($path)) {
+		file_put_contents('php://stderr', '*** ERROR: '.$name.' is not available ***'.PHP_EOL.
+			basename(__FILE__).' requires '.$path.' to be installed with it.'.PHP_EOL, FILE_APPEND);
+		exit(1);
+	}
+	return $path;
+}
+
+// Returns the gcc options to preprocess with flt-parse.h and flt.h kept with this script, -I. is for the program's own headers
+function get_preprocess_options($extra) {
+	return '-E -I. -I '.escapeshellarg(__DIR__).' -include '.escapeshellarg(get_header('flt-parse.h'))
+		.' -include '.escapeshellarg(get_header('flt.h')).' '.$extra;
+}
+
+// Each run gets its own private directory for the intermediate files, on tmpfs if available, kept with "-d"
+function get_workspace() {
+	static $workspace = null;
+	if ($workspace === null) {
+		$base = (is_dir('/dev/shm') && is_writable('/dev/shm'))? '/dev/shm': sys_get_temp_dir();
+		do
+			$workspace = $base.'/__FLT_TMP_'.getmypid().'_'.mt_rand();
+		while (!@mkdir($workspace, 0700));
+	}
+	return $workspace;
+}
+
+// Runs gcc with the code on stdin, or written to $file first, returns what gcc writes to stdout and stderr
+function run_gcc($options, $code, $file = null) {
+	$output = array(1 => '', 2 => '');
+	if ($file !== null) {
+		file_put_contents($file, $code);
+		$code = '';
+	}
+	$process = proc_open('gcc '.$options.' -x c '.(($file !== null)? escapeshellarg($file): '-'),
+		array(0 => array('pipe', 'r'), 1 => array('pipe', 'w'), 2 => array('pipe', 'w')), $pipes);
+	if (!is_resource($process))
+		return $output;
+	foreach ($pipes as $pipe)
+		stream_set_blocking($pipe, false);
+	// Write and read at the same time, so gcc never blocks on a full pipe
+	$written = 0;
+	$length = strlen($code);
+	if (!$length)
+		fclose($pipes[0]);
+	for (;;) {
+		$read = array();
+		foreach (array(1, 2) as $i)
+			if (!feof($pipes[$i]))
+				$read[$i] = $pipes[$i];
+		$write = ($written < $length)? array($pipes[0]): array();
+		$except = null;
+		if ((!$read && !$write) || stream_select($read, $write, $except, null) === false)
+			break;
+		if ($write) {
+			$count = fwrite($pipes[0], substr($code, $written, 65536));
+			// Stop writing if gcc has gone
+			$written = $count? $written + $count: $length;
+			if ($written >= $length)
+				fclose($pipes[0]);
+		}
+		foreach ($read as $i => $pipe)
+			$output[$i] .= fread($pipe, 65536);
+	}
+	fclose($pipes[1]);
+	fclose($pipes[2]);
+	proc_close($process);
+	return $output;
+}
+
+function preprocess($code, $pass, $extra, $debug) {
 	// List of (mostly) functions to replace
 	$fns = array(
-		'float' => 'FLT',		'double' => 'FLT',			'long FLT' => 'long double',
+		'float' => 'FLT',		'double' => 'FLT',
 		'DBL_MIN' => 'FLT_MIN',		'DBL_TRUE_MIN' => 'FLT_TRUE_MIN',	'DBL_MAX' => 'FLT_MAX',			'DBL_EPSILON' => 'FLT_EPSILON',
 		'acosf?' => 'flt_acos',		'acoshf?' => 'flt_acosh',		'asinf?' => 'flt_asin',			'asinhf?' => 'flt_asinh',
 		'atan2f?' => 'flt_atan2',	'atanf?' => 'flt_atan',			'atanhf?' => 'flt_atanh',		'atoff?' => 'flt_atof',
@@ -169,7 +354,7 @@ function preprocess($code, $pass, $extra) {
 		'ldexpf?' => 'flt_ldexp',	'log10f?' => 'flt_log10',		'log2f?' => 'flt_log2',			'logf?' => 'flt_log',
 		'modff?' => 'flt_modf',		'powf?' => 'flt_pow',			'roundf?' => 'flt_round',		'sinf?' => 'flt_sin',
 		'sinhf?' => 'flt_sinh',		'sqrtf?' => 'flt_sqrt',			'tanf?' => 'flt_tan',			'tanhf?' => 'flt_tanh',
-		'truncf?' => 'flt_trunc'
+		'truncf?' => 'flt_trunc',	'remquof?' => 'flt_remquo',		'copysignf?' => 'flt_copysign'
 	);
 	// First check if gcc is installed and is a supported version
 	$version = floatval(shell_exec('which gcc > /dev/null && gcc -dumpfullversion -dumpversion'));
@@ -190,64 +375,91 @@ function preprocess($code, $pass, $extra) {
 	$code = preg_replace('/(#\s*include\s*["<](?:math|float)\.h[">])/', '/* \1 */', $code);
 	// Normalize
 	$pass = substr('0'.$pass, -2);
-	// Files
-	$i_file = '__FLT_TMP_'.$pass.'.c';
-	$o_file = '__FLT_TMP_'.$pass.'.i';
-	$e_file = '__FLT_TMP_'.$pass.'.txt';
 	// Preprocess with gcc
-	file_put_contents($i_file, $code);
-	shell_exec('gcc -fdiagnostics-format=text -E -I. -include flt-parse.h -include flt.h '.$extra.' '.$i_file.' > '.$o_file.' 2> '.$e_file);
-	$code = file_get_contents($o_file);
+	list($output, $errors) = array_values(run_gcc('-fdiagnostics-format=text '.get_preprocess_options($extra), $code));
+	// Keep the files if debugging
+	if ($debug) {
+		file_put_contents(get_workspace().'/__FLT_TMP_'.$pass.'.c', $code);
+		file_put_contents(get_workspace().'/__FLT_TMP_'.$pass.'.i', $output);
+		file_put_contents(get_workspace().'/__FLT_TMP_'.$pass.'.txt', $errors);
+	}
+	$code = $output;
 	// Convert backslash and double quote escape sequences
 	$code = str_replace(array('\\\\', '\\"'), array('\x5c', '\x22'), $code);
-	// Temporarily hide all strings
-	preg_match_all('/"[^"]*"/', $code, $matches);
-	foreach ($matches[0] as $index => $match) {
-		$key = '__FLT_STR_'.substr('00000000'.$index, -9);
-		$code = str_replace($match, $key, $code);
-	}
-	// Replace existing functions
+	// Identifiers to replace, e.g. 'sqrt' and 'sqrtf' for 'sqrtf?', and the ones replaced by flt_* functions
+	$identifiers = array();
 	foreach ($fns as $regex => $fn)
-		$code = preg_replace('/\b'.$regex.'\b/', $fn, $code);
-	// Substitute floating point literals
-	$code = preg_replace('/('.FLT_LITERAL_REGEX.')/', 'flt_atof("\1")', $code);
-	// Remove unnecessary FLT casts
-	$code = preg_replace('/\(\s*'.FLT_TYPE_REGEX.'\s*\)\s*flt_/', 'flt_', $code);
-	// Restore the strings
-	foreach ($matches[0] as $index => $match) {
-		$key = '__FLT_STR_'.substr('00000000'.$index, -9);
-		$code = str_replace($key, $match, $code);
-	}
+		foreach ((substr($regex, -2) == 'f?')? array(substr($regex, 0, -2), substr($regex, 0, -1)): array($regex) as $identifier)
+			$identifiers[$identifier] = $fn;
+	$flt_fns = implode('|', array_keys(array_filter($identifiers, function($fn) { return strpos($fn, 'flt_') === 0; })));
+	// A single scan to skip strings, character constants, and comments, remove unnecessary FLT casts, replace
+	// identifiers, and substitute floating point literals
+	$code = preg_replace_callback('/"[^"]*"|\'(?:[^\'\\\\]|\\\\.)*\'|\/\*.*?\*\/|\/\/[^\n]*'
+		.'|\blong\s+(?:float|double)\b'
+		.'|(\(\s*(?:float|double|'.FLT_TYPE_REGEX.')\s*\)\s*)(?=flt_|(?:'.$flt_fns.')\b|(?:'.FLT_LITERAL_REGEX.'))'
+		.'|('.FLT_LITERAL_REGEX.')'
+		.'|([A-Za-z_][A-Za-z0-9_]*)'
+		.'|[0-9][A-Za-z0-9_]*/s',
+		function ($matches) use ($identifiers) {
+			// Identifier
+			if (isset($matches[3]) && strlen($matches[3]))
+				return isset($identifiers[$matches[3]])? $identifiers[$matches[3]]: $matches[3];
+			// Floating point literal
+			if (isset($matches[2]) && strlen($matches[2]))
+				return 'flt_atof("'.$matches[2].'")';
+			// Cast to be removed
+			if (isset($matches[1]) && strlen($matches[1]))
+				return '';
+			// Keep long double, otherwise leave strings, character constants, comments, and other numbers as is
+			return (strpos($matches[0], 'long') === 0)? 'long double': $matches[0];
+		}, $code);
 	// Remove any blank lines and directives
 	$lines = array_values(array_filter(explode(PHP_EOL, $code), function($line) { return strlen($line) && $line[0] != '#'; }));
 	// Done, return an array of lines
 	return $lines;
 }
 
-function compile(&$lines, &$substitutions, $pass, $debug, $final_passes = false) {
+function compile(&$lines, &$substitutions, $pass, $debug, $final_passes = false, $stack_buffers = false) {
 	// Normalize
 	$pass = substr('0'.$pass, -2);
-	// To keep track of which lines were modified
-	$modified = array();
+	// To keep track of the edits and line merges made in this pass, so that all the fixes that don't overlap can be applied at once
+	$spans = array();
+	$moves = array();
 	// Do a compile and get the messages
-	$i_file = '__FLT_TMP_'.$pass.'.c';
-	$e_file = '__FLT_TMP_'.$pass.'.json';
-	file_put_contents($i_file, implode(PHP_EOL, $lines));
-	shell_exec('gcc -fdiagnostics-format=json -c '.$i_file.' 2> '.$e_file);
-	$messages = json_decode(file_get_contents($e_file));
+	// gcc needs the source in a file to locate the directives within format strings
+	$file = get_workspace().'/__FLT_TMP_'.$pass.'.c';
+	list($output, $errors) = array_values(run_gcc('-fdiagnostics-format=json -fsyntax-only', implode(PHP_EOL, $lines), $file));
+	// Keep the files if debugging
+	if ($debug)
+		file_put_contents(get_workspace().'/__FLT_TMP_'.$pass.'.json', $errors);
+	else
+		@unlink($file);
+	$messages = json_decode($errors);
 	// Join any multiline messages
+	$modified = array();
 	join_multiline_messages($lines, $messages, $modified);
+	record_merges($spans, $moves, $modified);
 	// Continue processing
 	foreach ($messages as $message) {
+		// Skip any message overlapping an earlier edit, otherwise update its lines and columns to match the edited lines
+		if (!($message = get_current_message($message, $spans, $moves)))
+			continue;
 		if ($debug) {
 			foreach ($message->locations as $location) {
 				list($l, $start, $finish) = get_token_extent($location);
-				if (!in_array($l, $modified))
-					file_put_contents('php://stderr', 'line '.$l.' - '.$message->message.PHP_EOL
-						.$lines[$l].PHP_EOL
-						.str_repeat('.', $start).str_repeat('*', $finish - $start + 1).PHP_EOL, FILE_APPEND);
+				file_put_contents('php://stderr', 'line '.$l.' - '.$message->message.PHP_EOL
+					.$lines[$l].PHP_EOL
+					.str_repeat('.', $start).str_repeat('*', $finish - $start + 1).PHP_EOL, FILE_APPEND);
 			}
 		}
+		// Keep the lines that could be changed, i.e. the lines of the message and either side for any merges
+		$before = array();
+		foreach ($message->locations as $location) {
+			list($l, $start, $finish) = get_token_extent($location);
+			for ($i = max($l - 1, 0); $i <= $l + 1 && $i < count($lines); ++$i)
+				$before[$i] = $lines[$i];
+		}
+		$modified = array();
 		switch ($message->message) {
 			case "initializer element is not constant":
 				if ($final_passes)
@@ -294,8 +506,8 @@ function compile(&$lines, &$substitutions, $pass, $debug, $final_passes = false)
 				break;
 			default:
 				// Needed for some cases
-				$fn1 = check_for_signed_or_unsigned($message, 'flt_ltof', 'flt_ultof');
-				$fn2 = check_for_signed_or_unsigned($message, 'flt_ftol', 'flt_ftoul');
+				$fn1 = get_integer_conversion($message, true);
+				$fn2 = get_integer_conversion($message, false);
 				if (preg_match("/incompatible types when assigning to type ‘".INT_TYPE_REGEX."’ from type ‘FLT’/", $message->message))
 					process_assignment($lines, $message, $modified, $fn2);
 				else if (preg_match("/incompatible types when assigning to type ‘[_a-zA-Z0-9]+’ \{aka ‘".INT_TYPE_REGEX."’\} from type ‘FLT’/", $message->message))
@@ -325,10 +537,10 @@ function compile(&$lines, &$substitutions, $pass, $debug, $final_passes = false)
 				else if (preg_match("/incompatible type for argument [0-9]+ of ‘[^’]+’/", $message->message)
 					&& (preg_match ("/expected ‘".INT_TYPE_REGEX."’ but argument is of type ‘FLT’/", $message->children[0]->message)
 						|| preg_match ("/expected ‘".INT_TYPE_REGEX."’ \{aka ‘".INT_TYPE_REGEX."’\} but argument is of type ‘FLT’/", $message->children[0]->message)))
-					process_incompatible_type($lines, $message, $modified, check_for_signed_or_unsigned($message->children[0], 'flt_ftol', 'flt_ftoul'));
-				else if (preg_match("/format ‘%l?[EeFfGg]’ expects argument of type ‘(?:float|double)’, but argument [0-9]+ has type ‘FLT’/", $message->message))
-					process_printf_argument($lines, $message, $modified);
-				else if (preg_match("/format ‘%l?[EeFfGg]’ expects argument of type ‘(?:float|double) \*’, but argument [0-9]+ has type ‘FLT \*’/", $message->message))
+					process_incompatible_type($lines, $message, $modified, get_integer_conversion($message->children[0], false));
+				else if (preg_match("/format ‘%l?[AaEeFfGg]’ expects argument of type ‘(?:float|double)’, but argument [0-9]+ has type ‘FLT’/", $message->message))
+					process_printf_argument($lines, $message, $modified, $stack_buffers);
+				else if (preg_match("/format ‘%l?[AaEeFfGg]’ expects argument of type ‘(?:float|double) \*’, but argument [0-9]+ has type ‘FLT \*’/", $message->message))
 					process_scanf_argument($lines, $message, $modified);
 				else if (preg_match("/expected ‘=’, ‘,’, ‘;’, ‘asm’ or ‘__attribute__’ before ‘[^’]+’/", $message->message))
 					process_non_gcc_extension($lines, $substitutions, $message, $modified);
@@ -356,15 +568,140 @@ function compile(&$lines, &$substitutions, $pass, $debug, $final_passes = false)
 					process_unhandled($message);
 				break;
 		}
+		// Record the edits, the lines merged from or onto are followed instead
+		$merged = array();
+		foreach ($modified as $l => $merge)
+			if (is_array($merge))
+				$merged[$l] = $merged[$merge[0]] = true;
+		foreach ($before as $l => $line)
+			if (!isset($merged[$l]) && $lines[$l] !== $line)
+				add_span($spans, $l, $line, $lines[$l]);
+		foreach ($modified as $l => $merge)
+			if (!isset($merged[$l]) && !array_key_exists($l, $before))
+				$spans[$l] = array(array(0, PHP_INT_MAX, 0));
+		record_merges($spans, $moves, $modified);
 	}
 	// Tidy up
-	if ($modified)
+	if ($spans || $moves)
 		$lines = array_values(array_filter($lines, function($line) { return strlen($line); }));
 	// Done if no longer modified
-	return !$modified;
+	return !$spans && !$moves;
+}
+
+// Returns a copy of the message with the lines and columns moved to where the text is now, or null if it overlaps an earlier edit
+function get_current_message($message, $spans, $moves) {
+	$message = json_decode(json_encode($message));
+	foreach ($message->locations as $location) {
+		// Follow any merged lines
+		foreach (array('caret', 'start', 'finish') as $property) {
+			if (property_exists($location, $property)) {
+				$t = $location->{$property};
+				for ($l = $t->line - 1; array_key_exists($l, $moves); $l = $moves[$l][0])
+					$t->{'byte-column'} += $moves[$l][1];
+				$t->line = $l + 1;
+			}
+		}
+		list($l, $start, $finish) = get_token_extent($location);
+		if (!array_key_exists($l, $spans))
+			continue;
+		$shift = 0;
+		foreach ($spans[$l] as list($span_start, $span_finish, $delta)) {
+			// Touching counts as overlapping, e.g. something inserted right before the token
+			if ($start <= $span_finish && $finish >= $span_start)
+				return null;
+			if ($span_finish < $start)
+				$shift += $delta;
+		}
+		foreach (array('caret', 'start', 'finish') as $property)
+			if (property_exists($location, $property))
+				$location->{$property}->{'byte-column'} += $shift;
+	}
+	return $message;
+}
+
+// Spans are kept per line as array(start, finish, delta) in the columns gcc reported, with finish being exclusive
+function add_span(&$spans, $l, $old, $new) {
+	$old_length = strlen($old);
+	$new_length = strlen($new);
+	// The edit is whatever is between the common prefix and the common suffix
+	for ($prefix = 0; $prefix < $old_length && $prefix < $new_length && $old[$prefix] == $new[$prefix]; ++$prefix);
+	for ($suffix = 0; $suffix < $old_length - $prefix && $suffix < $new_length - $prefix
+		&& $old[$old_length - $suffix - 1] == $new[$new_length - $suffix - 1]; ++$suffix);
+	$start = $prefix;
+	$finish = $old_length - $suffix;
+	$delta = $new_length - $old_length;
+	if (!array_key_exists($l, $spans)) {
+		$spans[$l] = array(array($start, $finish, $delta));
+		return;
+	}
+	// Convert to the gcc columns, expanding to include any earlier edit that is touched
+	$shift = 0;
+	$start_found = $finish_found = false;
+	foreach ($spans[$l] as list($span_start, $span_finish, $span_delta)) {
+		if (!$start_found && $start <= $span_finish + $shift + $span_delta) {
+			$start = ($start < $span_start + $shift)? $start - $shift: $span_start;
+			$start_found = true;
+		}
+		if (!$finish_found && $finish <= $span_finish + $shift + $span_delta) {
+			$finish = ($finish < $span_start + $shift)? $finish - $shift: $span_finish;
+			$finish_found = true;
+		}
+		$shift += $span_delta;
+	}
+	if (!$start_found)
+		$start -= $shift;
+	if (!$finish_found)
+		$finish -= $shift;
+	// Merge with any touched edits
+	$merged = array();
+	foreach ($spans[$l] as $span) {
+		list($span_start, $span_finish, $span_delta) = $span;
+		if ($span_start <= $finish && $span_finish >= $start) {
+			$start = min($start, $span_start);
+			$finish = max($finish, $span_finish);
+			$delta += $span_delta;
+		} else
+			$merged[] = $span;
+	}
+	$merged[] = array($start, $finish, $delta);
+	usort($merged, function($a, $b) { return $a[0] - $b[0]; });
+	$spans[$l] = $merged;
 }
 
-function postprocess($lines, $substitutions) {
+// Records the lines merged by merge_next_line, merge_previous_line, or join_multiline_messages, as the line the text was
+// moved onto and the shift in columns, carrying over any edits already made. Merges that can't be followed, e.g. of a line
+// already merged in this pass, leave the line for the next pass.
+function record_merges(&$spans, &$moves, $modified) {
+	$merges = array();
+	foreach ($modified as $j => $merge) {
+		if (is_array($merge)) {
+			list($i, $column, $lead) = $merge;
+			if (array_key_exists($i, $moves) || array_key_exists($j, $moves) || (array_key_exists($j, $spans) && $spans[$j][0][0] < $lead))
+				$spans[$j] = array(array(0, PHP_INT_MAX, 0));
+			else {
+				$delta = 0;
+				if (array_key_exists($i, $spans))
+					foreach ($spans[$i] as $span)
+						$delta += $span[2];
+				$merges[$j] = array($i, $column - $delta - $lead);
+			}
+		}
+	}
+	foreach ($merges as $j => $move)
+		$moves[$j] = $move;
+	foreach ($merges as $j => $move) {
+		if (array_key_exists($j, $spans)) {
+			for ($i = $j, $shift = 0; array_key_exists($i, $moves); $i = $moves[$i][0])
+				$shift += $moves[$i][1];
+			foreach ($spans[$j] as list($start, $finish, $delta))
+				$spans[$i][] = array($start + $shift, $finish + $shift, $delta);
+			usort($spans[$i], function($a, $b) { return $a[0] - $b[0]; });
+			unset($spans[$j]);
+		}
+	}
+}
+
+function postprocess($lines, $substitutions, $fuse, $fast, $debug) {
 	// Get the code back
 	$code = implode(PHP_EOL, $lines);
 	// Correct the typedef for FLT
@@ -376,21 +713,681 @@ function postprocess($lines, $substitutions) {
 			'/* Converted to FLT using '.basename(__FILE__).' v'.FLT_VERSION.' on '.gmdate('c').' */',
 			'typedef uint32_t FLT;'.PHP_EOL.'\1'
 		), $code);
-	// Convert flt_atof("###"), flt_ltof(###), and flt_ultof(###) to compatible literals
+	// Convert flt_atof("###"), and flt_ltof(###) and the other integer conversions of constants, to compatible literals
 	$code = preg_replace_callback(
 		array(
 			'/flt_atof\(\s*"([^"]+)"\s*\)/',
-			'/flt_u?ltof\(\s*([-+]?\s*[0-9]+)\s*\)/'
+			'/flt_(?:u?ltof|u?itof(?:16)?|uctof)\(\s*([-+]?\s*[0-9]+)\s*\)/'
 		),
 		function ($matches) {
-			return '0x'.strtoupper(bin2hex(pack('G', floatval(preg_replace('/\s/', '', $matches[1]))))).' /* '.$matches[1].' */';
+			return '0x'.strtoupper(bin2hex(pack('G', literal_floatval(preg_replace('/\s/', '', $matches[1]))))).' /* '.$matches[1].' */';
 		}, $code);
+	// Evaluate constant expressions
+	$code = fold_constants($code);
+	// Transformations that aren't exact under IEEE 754
+	if ($fast)
+		$code = fast_transformations($code);
+	// Work on the bits directly for trivial operations
+	$code = inline_trivial_operations($code);
+	// Convert integers once where they don't change
+	$code = reuse_conversions($code, $debug);
+	// Evaluate nested arithmetic with the expression kernel
+	if ($fuse)
+		$code = fuse_expressions($code);
 	// Restore substitutions
 	foreach (array_reverse($substitutions) as $substitution)
 		$code = str_replace($substitution[0], $substitution[1], $code);
 	return $code;
 }
 
+// Replaces flt_add, flt_subtract, flt_multiply, flt_divide, flt_negated, and flt_fabs of literals with the literal result,
+// repeating until nothing changes so whole constant expressions become one literal
+function fold_constants($code) {
+	$literal = '0x[0-9A-F]{8} \/\* (?:[^*]|\*(?!\/))* \*\/';
+	$symbols = array('add' => ' + ', 'subtract' => ' - ', 'multiply' => ' * ', 'divide' => ' / ');
+	do {
+		$folded = 0;
+		// Redundant brackets around a literal, but not the brackets of a call, a cast, or a statement like if or while
+		$code = preg_replace_callback('/([\w)\]]\s*)?\(\s*('.$literal.')\s*\)/',
+			function ($matches) {
+				return $matches[1] == ''? $matches[2]: $matches[0];
+			}, $code);
+		$code = preg_replace_callback(
+			array(
+				'/\bflt_(add|subtract|multiply|divide)\(\s*('.$literal.')\s*,\s*('.$literal.')\s*\)/',
+				'/\bflt_(negated|fabs)\(\s*('.$literal.')\s*\)/'
+			),
+			function ($matches) use ($symbols, &$folded) {
+				$operands = $comments = array();
+				foreach (array_slice($matches, 2) as $operand) {
+					$operands[] = unpack('G', hex2bin(substr($operand, 2, 8)))[1];
+					$comments[] = substr($operand, 14, -3);
+				}
+				// Leave division by zero, infinities, and NaN to be evaluated at run time
+				if ($matches[1] == 'divide' && !$operands[1])
+					return $matches[0];
+				$result = call_user_func_array('flt_'.$matches[1], $operands);
+				if (!is_finite($result))
+					return $matches[0];
+				// Bracket compound operands in the comment
+				$bracketed = preg_replace('/^.* .*$/', '(\0)', $comments);
+				if (isset($symbols[$matches[1]]))
+					$comment = implode($symbols[$matches[1]], $bracketed);
+				else if ($matches[1] == 'negated')
+					$comment = '-'.$bracketed[0];
+				else
+					$comment = 'fabs('.$comments[0].')';
+				++$folded;
+				return '0x'.strtoupper(bin2hex(pack('G', $result))).' /* '.$comment.' */';
+			}, $code);
+	} while ($folded);
+	return $code;
+}
+
+// Replaces negation, fabs, copysign, isinf, isnan, iszero, fsgn, and comparisons against zero with the bit operations of
+// FLT_NEGATED, FLT_FABS, etc. in flt.h, the output being preprocessed already
+function inline_trivial_operations($code) {
+	// Operands are substituted for %1$s and %2$s, a simple operand is needed for anything using them more than once
+	$operations = array(
+		'flt_negated' => '((FLT)((%1$s) ^ 0x80000000UL))',
+		'flt_fabs' => '((FLT)((%1$s) & 0x7FFFFFFFUL))',
+		'flt_copysign' => '((FLT)(((%1$s) & 0x7FFFFFFFUL) | ((%2$s) & 0x80000000UL)))',
+		'flt_isinf' => '(((%1$s) & 0x7FFFFFFFUL) == 0x7F800000UL)',
+		'flt_isnan' => '(((%1$s) & 0x7FFFFFFFUL) > 0x7F800000UL)',
+		'flt_iszero' => '(!((%1$s) & 0x7FFFFFFFUL))',
+		'flt_fsgn' => '((int)((FLT)((%1$s) - 0x00000001UL) < 0x7F800000UL) - (int)((FLT)((%1$s) - 0x80000001UL) < 0x7F800000UL))',
+		'E_EQUAL_TO' => '(!((%1$s) & 0x7FFFFFFFUL))',
+		'E_NOT_EQUAL_TO' => '(!!((%1$s) & 0x7FFFFFFFUL))',
+		'E_LESS_THAN' => '((FLT)((%1$s) - 0x80000001UL) < 0x7F800000UL)',
+		'E_GREATER_THAN' => '((FLT)((%1$s) - 0x00000001UL) < 0x7F800000UL)',
+		'E_LESS_THAN_OR_EQUAL_TO' => '(!((%1$s) & 0x7FFFFFFFUL) || (FLT)((%1$s) - 0x80000001UL) < 0x7F800000UL)',
+		'E_GREATER_THAN_OR_EQUAL_TO' => '(!((%1$s) & 0x7FFFFFFFUL) || (FLT)((%1$s) - 0x00000001UL) < 0x7F800000UL)'
+	);
+	// Swapped for zero on the left
+	$swapped = array(
+		'E_LESS_THAN' => 'E_GREATER_THAN', 'E_GREATER_THAN' => 'E_LESS_THAN',
+		'E_LESS_THAN_OR_EQUAL_TO' => 'E_GREATER_THAN_OR_EQUAL_TO', 'E_GREATER_THAN_OR_EQUAL_TO' => 'E_LESS_THAN_OR_EQUAL_TO'
+	);
+	return rewrite_calls($code, 'flt_(?:negated|fabs|copysign|isinf|isnan|iszero|fsgn|compare)',
+		function ($fn, $arguments) use ($operations, $swapped) {
+			$key = $fn;
+			if ($fn == 'flt_compare') {
+				// Only comparisons against a zero literal
+				$key = (count($arguments) == 3)? $arguments[2]: '';
+				if (isset($operations[$key]) && is_zero_literal($arguments[1]))
+					$arguments = array($arguments[0]);
+				else if (isset($operations[$key]) && is_zero_literal($arguments[0])) {
+					$arguments = array($arguments[1]);
+					if (isset($swapped[$key]))
+						$key = $swapped[$key];
+				} else
+					return null;
+			}
+			if (isset($operations[$key]) && count($arguments) == ((strpos($operations[$key], '%2$s') === false)? 1: 2)
+				&& (substr_count($operations[$key], '%1$s') == 1 || is_simple_operand($arguments[0])))
+				return vsprintf($operations[$key], $arguments);
+			return null;
+		});
+}
+
+// Rewrites the calls to the functions matching $names, innermost first, $callback gets the function and its arguments and
+// returns the replacement, or null to keep the call
+function rewrite_calls($code, $names, $callback) {
+	$output = '';
+	for ($i = 0; preg_match('/["\']|\b('.$names.')\s*\(/', $code, $matches, PREG_OFFSET_CAPTURE, $i); ) {
+		$k = $matches[0][1];
+		$output .= substr($code, $i, $k - $i);
+		if (!isset($matches[1])) {
+			$i = skip_literal($code, $k);
+			$output .= substr($code, $k, $i - $k);
+			continue;
+		}
+		$i = $k + strlen($matches[0][0]);
+		// A type name before it makes it a declaration, e.g. the prototypes from flt.h
+		if (preg_match('/(?<![\w.>])(?!(?:return|case|sizeof|else|do)\b)[A-Za-z_]\w*\s*$/', substr($output, -64))
+			|| !($parsed = parse_call_arguments($code, $i))) {
+			$output .= $matches[0][0];
+			continue;
+		}
+		list($i, $arguments) = $parsed;
+		foreach ($arguments as &$argument)
+			$argument = rewrite_calls($argument, $names, $callback);
+		unset($argument);
+		$fn = $matches[1][0];
+		$replacement = $callback($fn, $arguments);
+		$output .= ($replacement === null)? $fn.'('.implode(', ', $arguments).')': $replacement;
+	}
+	return $output.substr($code, $i);
+}
+
+// Identifiers and members can be used more than once in an expression without side effects
+function is_simple_operand($operand) {
+	return preg_match('/^[A-Za-z_]\w*(?:\s*(?:\.|->)\s*[A-Za-z_]\w*)*$/', $operand);
+}
+
+function is_zero_literal($operand) {
+	return ($literal = parse_literal($operand)) && !($literal[2] & 0x7FFFFFFF);
+}
+
+// Returns the value, comment, and bits of a literal converted in postprocess, or null if not a literal
+function parse_literal($operand) {
+	if (!preg_match('/^0x([0-9A-F]{8}) \/\* ((?:[^*]|\*(?!\/))*) \*\/$/', $operand, $matches))
+		return null;
+	return array(unpack('G', hex2bin($matches[1]))[1], $matches[2], hexdec($matches[1]));
+}
+
+function format_literal($value, $comment) {
+	return '0x'.strtoupper(bin2hex(pack('G', $value))).' /* '.$comment.' */';
+}
+
+// Brackets a compound expression in a literal comment
+function bracket_comment($comment) {
+	return (strpos($comment, ' ') === false)? $comment: '('.$comment.')';
+}
+
+// Returns the function and arguments if $operand is just a call, or null if not
+function parse_call($operand) {
+	if (!preg_match('/^(flt_\w+)\s*\(/', $operand, $matches) || !($parsed = parse_call_arguments($operand, strlen($matches[0])))
+		|| $parsed[0] != strlen($operand))
+		return null;
+	return array($matches[1], $parsed[1]);
+}
+
+// Transformations for -O fast that aren't exact under IEEE 754, or are exact only for the operands involved
+function fast_transformations($code) {
+	$code = hoist_reciprocals($code);
+	$code = rewrite_calls($code, 'flt_(?:add|subtract|multiply|divide|compare)', 'fast_rewrite');
+	// Scaling by a power of two adjusts the exponent, after the constants are combined
+	return rewrite_calls($code, 'flt_multiply', function ($fn, $arguments) {
+		foreach (array(1, 0) as $j)
+			if (count($arguments) == 2 && ($literal = parse_literal($arguments[$j])) && !($literal[2] & 0x807FFFFF)
+				&& ($literal[2] & 0x7F800000) && ($literal[2] & 0x7F800000) != 0x7F800000)
+				return ($literal[2] == 0x3F800000)? $arguments[1 - $j]: 'flt_ldexp('.$arguments[1 - $j].', '.(($literal[2] >> 23) - 127).')';
+		return null;
+	});
+}
+
+function fast_rewrite($fn, $arguments) {
+	$symbols = array('flt_add' => ' + ', 'flt_subtract' => ' - ', 'flt_multiply' => ' * ', 'flt_divide' => ' / ');
+	if ($fn == 'flt_compare')
+		return fast_compare($arguments);
+	if (count($arguments) != 2)
+		return null;
+	list($left, $right) = $arguments;
+	// Narrow integers are exact in FLT, and so are their sums, differences, and products in 32 bits, so convert just once
+	if ($fn != 'flt_divide' && ($a = parse_call($left)) && ($b = parse_call($right))
+		&& preg_match('/^flt_(?:itof16|uitof16|uctof)$/', $a[0]) && preg_match('/^flt_(?:itof16|uitof16|uctof)$/', $b[0])) {
+		if ($fn == 'flt_multiply' && $a[0] != 'flt_itof16' && $b[0] != 'flt_itof16')
+			return 'flt_ultof((uint32_t)('.$a[1][0].') * (uint32_t)('.$b[1][0].'))';
+		return 'flt_ltof((int32_t)('.$a[1][0].')'.$symbols[$fn].'(int32_t)('.$b[1][0].'))';
+	}
+	// Subtracting a constant is adding its negation
+	if ($fn == 'flt_subtract' && ($c = parse_literal($right)))
+		return fast_rewrite('flt_add', array($left, format_literal(-$c[0], '-'.bracket_comment($c[1]))));
+	// Dividing by a constant is multiplying by its reciprocal
+	if ($fn == 'flt_divide' && ($c = parse_literal($right)) && $c[0] && is_finite($c[0]) && ($r = flt_divide(1.0, $c[0])) && is_finite($r))
+		return fast_rewrite('flt_multiply', array($left, format_literal($r, '1 / '.bracket_comment($c[1]))));
+	if ($fn == 'flt_add' || $fn == 'flt_multiply') {
+		// Constants on the right, then combine them, e.g. (x + a) + b is x + (a + b)
+		if (parse_literal($left) && !parse_literal($right))
+			list($left, $right) = array($right, $left);
+		if (($c = parse_literal($right)) && ($inner = parse_call($left)) && $inner[0] == $fn && count($inner[1]) == 2
+			&& ($d = parse_literal($inner[1][1])) && is_finite($value = call_user_func($fn, $d[0], $c[0])))
+			return $fn.'('.$inner[1][0].', '.format_literal($value, bracket_comment($d[1]).$symbols[$fn].bracket_comment($c[1])).')';
+		return $fn.'('.$left.', '.$right.')';
+	}
+	return null;
+}
+
+// Comparisons ignoring NaN, against a constant as signed integers, or against another simple operand by signed magnitude
+function fast_compare($arguments) {
+	$operators = array(
+		'E_EQUAL_TO' => '==', 'E_NOT_EQUAL_TO' => '!=', 'E_LESS_THAN' => '<', 'E_GREATER_THAN' => '>',
+		'E_LESS_THAN_OR_EQUAL_TO' => '<=', 'E_GREATER_THAN_OR_EQUAL_TO' => '>='
+	);
+	$swapped = array('==' => '==', '!=' => '!=', '<' => '>', '>' => '<', '<=' => '>=', '>=' => '<=');
+	if (count($arguments) != 3 || !isset($operators[$arguments[2]]))
+		return null;
+	list($left, $right) = $arguments;
+	$op = $operators[$arguments[2]];
+	if (parse_literal($left) && !parse_literal($right)) {
+		list($left, $right) = array($right, $left);
+		$op = $swapped[$op];
+	}
+	if ($c = parse_literal($right)) {
+		$bits = $c[2];
+		// Zero is left to inline_trivial_operations, and NaN to flt_compare
+		if (!($bits & 0x7FFFFFFF) || is_nan($c[0]))
+			return null;
+		if ($op == '==' || $op == '!=')
+			return '((FLT)('.$left.') '.$op.' '.sprintf('0x%08XUL', $bits).')';
+		// Positive FLT order the same as their bits as signed integers, and negative FLT the same with the magnitude inverted,
+		// either way anything of the opposite sign is on the correct side of the constant
+		if ($bits & 0x80000000)
+			return '((int32_t)(('.$left.') ^ 0x7FFFFFFFUL) '.$op.' '.(-1 - ($bits & 0x7FFFFFFF)).'L)';
+		return '((int32_t)('.$left.') '.$op.' '.$bits.'L)';
+	}
+	if (is_simple_operand($left) && is_simple_operand($right)) {
+		$key = '(((%1$s) & 0x80000000UL)? -(int32_t)((%1$s) & 0x7FFFFFFFUL): (int32_t)(%1$s))';
+		return '('.sprintf($key, $left).' '.$op.' '.sprintf($key, $right).')';
+	}
+	return null;
+}
+
+// Multiplies by the reciprocal of a divisor that doesn't change in a loop, calculated once before the loop
+function hoist_reciprocals($code) {
+	$count = 0;
+	do {
+		$hoisted = false;
+		$functions = find_functions($code);
+		foreach (find_loops($code) as list($start, $body, $end)) {
+			if (!($function = get_enclosing_function($code, $functions, $start, $end)))
+				continue;
+			$loop = substr($code, $start, $end - $start);
+			preg_match_all('/\bflt_divide\s*\(/', $loop, $matches, PREG_OFFSET_CAPTURE);
+			foreach ($matches[0] as list($match, $k)) {
+				if (!($parsed = parse_call_arguments($loop, $k + strlen($match))) || count($parsed[1]) != 2
+					|| !is_loop_invariant($divisor = $parsed[1][1], FLT_TYPE_REGEX, $loop, $function))
+					continue;
+				$name = 'flt_reciprocal_'.$count;
+				$rewritten = rewrite_calls($loop, 'flt_divide', function ($fn, $arguments) use ($divisor, $name) {
+					return (count($arguments) == 2 && $arguments[1] == $divisor)? 'flt_multiply('.$arguments[0].', '.$name.')': null;
+				});
+				if ($rewritten == $loop)
+					continue;
+				// In a block of its own so it can be declared
+				$code = substr($code, 0, $start).'{ FLT '.$name.' = flt_inverted('.$divisor.'); '.$rewritten.' }'.substr($code, $end);
+				++$count;
+				$hoisted = true;
+				break 2;
+			}
+		}
+	} while ($hoisted);
+	return $code;
+}
+
+// Returns the function definitions as the start of the declaration, and the start and end of the body
+function find_functions($code) {
+	$functions = array();
+	$depth = 0;
+	$declaration = 0;
+	preg_match_all('/"(?:[^"\\\\]|\\\\.)*"|\'(?:[^\'\\\\]|\\\\.)*\'|\/\*.*?\*\/|[{};]/s', $code, $matches, PREG_OFFSET_CAPTURE);
+	foreach ($matches[0] as list($match, $k)) {
+		if ($match == '{') {
+			if (!$depth++ && preg_match('/\)\s*$/', substr($code, $declaration, $k - $declaration)))
+				$body = $k;
+			else if ($depth == 1)
+				$body = -1;
+		} else if ($match == '}') {
+			if (!--$depth) {
+				if ($body >= 0)
+					$functions[] = array($declaration, $body, $k + 1);
+				$declaration = $k + 1;
+			}
+		} else if ($match == ';' && !$depth)
+			$declaration = $k + 1;
+	}
+	return $functions;
+}
+
+// Returns the text of the function containing $start to $end, or null if not in a function
+function get_enclosing_function($code, $functions, $start, $end) {
+	// The functions are in order and don't overlap, so only the last body starting before $start can contain it
+	for ($low = 0, $high = count($functions); $low < $high; ) {
+		$middle = ($low + $high) >> 1;
+		if ($functions[$middle][1] < $start)
+			$low = $middle + 1;
+		else
+			$high = $middle;
+	}
+	if ($low && $end <= $functions[$low - 1][2])
+		return substr($code, $functions[$low - 1][0], $functions[$low - 1][2] - $functions[$low - 1][0]);
+	return null;
+}
+
+// Returns the for and while loops as the start of the keyword, and the start and end of the body, only for bodies in braces
+// or single statements that aren't control statements themselves
+function find_loops($code) {
+	$loops = array();
+	preg_match_all('/"(?:[^"\\\\]|\\\\.)*"|\'(?:[^\'\\\\]|\\\\.)*\'|\/\*.*?\*\/|\b(?:for|while)\s*\(/s', $code, $matches, PREG_OFFSET_CAPTURE);
+	foreach ($matches[0] as list($match, $start)) {
+		if (!preg_match('/^(?:for|while)/', $match) || !($parsed = parse_call_arguments($code, $start + strlen($match))))
+			continue;
+		$body = $parsed[0] + strspn($code, " \t\r\n", $parsed[0]);
+		if ($body >= strlen($code) || $code[$body] == ';' || preg_match('/\G(?:if|for|while|do|switch|else)\b/', $code, $keyword, 0, $body))
+			continue;
+		if ($code[$body] == '{')
+			$parsed = parse_call_arguments($code, $body + 1);
+		else
+			$parsed = find_statement_end($code, $body);
+		if ($parsed)
+			$loops[] = array($start, $body, $parsed[0]);
+	}
+	return $loops;
+}
+
+// Returns the end of the statement starting at $i, after the semicolon, in the same form as parse_call_arguments
+function find_statement_end($code, $i) {
+	// Skipping to the next character that matters
+	for ($level = 0, $length = strlen($code); $i < $length && ($i += strcspn($code, '"\'()[]{};', $i)) < $length; ++$i) {
+		$c = $code[$i];
+		if ($c == '"' || $c == "'")
+			$i = skip_literal($code, $i) - 1;
+		else if (strpos('([{', $c) !== false)
+			++$level;
+		else if (strpos(')]}', $c) !== false)
+			--$level;
+		else if ($c == ';' && !$level)
+			return array($i + 1, array());
+	}
+	return null;
+}
+
+// Whether $name is a local variable or a parameter of $type that isn't changed in $loop and never has its address taken
+function is_loop_invariant($name, $type, $loop, $function) {
+	if (!preg_match('/^[A-Za-z_]\w*$/', $name))
+		return false;
+	$declaration = '/\b(?:'.$type.')\s+(?:[A-Za-z_]\w*\s*(?:=[^,;()]*)?,\s*)*'.$name.'\s*[,;=)]/';
+	return preg_match($declaration, $function) && !preg_match($declaration, $loop) && !preg_match('/&\s*'.$name.'\b/', $function)
+		&& !preg_match('/\b'.$name.'\s*(?:[-+*\/%&|^]|<<|>>)?=(?!=)|(?:\+\+|--)\s*'.$name.'\b|\b'.$name.'\s*(?:\+\+|--)/', $loop);
+}
+
+// Hoists integer to FLT conversions of variables that don't change in a loop to before the loop, then reuses repeated
+// conversions of a variable in a basic block, with -d reporting each to php://stderr
+function reuse_conversions($code, $debug) {
+	$conversion = '/\b(flt_(?:u?ltof|u?itof(?:16)?|uctof))\(\s*([A-Za-z_]\w*)\s*\)/';
+	$count = 0;
+	$reports = array();
+	// Outer loops are found first, and the same conversion in an inner loop is hoisted along with them
+	do {
+		$hoisted = false;
+		$functions = find_functions($code);
+		foreach (find_loops($code) as list($start, $body, $end)) {
+			if (!($function = get_enclosing_function($code, $functions, $start, $end)))
+				continue;
+			$loop = substr($code, $start, $end - $start);
+			preg_match_all($conversion, $loop, $matches, PREG_SET_ORDER);
+			foreach ($matches as list(, $fn, $name)) {
+				if (!is_loop_invariant($name, INT_TYPE_REGEX, $loop, $function))
+					continue;
+				$temp = 'flt_conversion_'.$count;
+				$rewritten = rewrite_calls($loop, $fn, function ($fn, $arguments) use ($name, $temp) {
+					return ($arguments == array($name))? $temp: null;
+				});
+				if ($rewritten == $loop)
+					continue;
+				// In a block of its own so it can be declared
+				$code = substr($code, 0, $start).'{ FLT '.$temp.' = '.$fn.'('.$name.'); '.$rewritten.' }'.substr($code, $end);
+				$reports[] = array(substr_count($code, "\n", 0, $start) + 1, 'hoisted '.$fn.'('.$name.') out of the loop as '.$temp);
+				++$count;
+				$hoisted = true;
+				break 2;
+			}
+		}
+	} while ($hoisted);
+	// Working back from the end so the positions found still apply
+	foreach (array_reverse(find_functions($code)) as list($declaration, $body, $finish)) {
+		$function = substr($code, $declaration, $finish - $declaration);
+		$temps = array();
+		foreach (array_reverse(find_basic_blocks($code, $body + 1, $finish - 1)) as $extents) {
+			$statements = array();
+			foreach ($extents as list($start, $end))
+				$statements[] = substr($code, $start, $end - $start);
+			// Without the text of any string or character constants
+			$stripped = preg_replace('/"(?:[^"\\\\]|\\\\.)*"|\'(?:[^\'\\\\]|\\\\.)*\'/', '0', $statements);
+			preg_match_all($conversion, implode(' ', $stripped), $matches, PREG_SET_ORDER);
+			$conversions = array();
+			foreach ($matches as list(, $fn, $name))
+				$conversions[$fn.'('.$name.')'] = array($fn, $name);
+			foreach ($conversions as list($fn, $name)) {
+				// The first conversion has to be evaluated unconditionally, and before any of the others
+				$using = array();
+				foreach ($stripped as $k => $statement)
+					if (preg_match('/\b'.$fn.'\(\s*'.$name.'\s*\)/', $statement)
+						&& ($using || !preg_match('/&&|\|\||\?/', $statement)))
+						$using[] = $k;
+				if (count($using) < 2
+					|| !is_loop_invariant($name, INT_TYPE_REGEX, implode(' ', array_slice($stripped, $using[0])), $function))
+					continue;
+				$temp = 'flt_conversion_'.$count;
+				// Any others in the first statement are left as they are, the order they are evaluated in isn't known
+				foreach ($using as $k) {
+					$state = ($k == $using[0])? 'assign': 'use';
+					$statements[$k] = rewrite_calls($statements[$k], $fn, function ($fn, $arguments) use ($name, $temp, &$state) {
+						if ($arguments != array($name) || $state == 'keep')
+							return null;
+						if ($state == 'use')
+							return $temp;
+						$state = 'keep';
+						return '('.$temp.' = '.$fn.'('.$name.'))';
+					});
+				}
+				$reports[] = array(substr_count($code, "\n", 0, $extents[$using[0]][0]) + 1,
+					'reused '.$fn.'('.$name.') in '.(count($using) - 1).' later statement'.((count($using) > 2)? 's': '').' as '.$temp);
+				$temps[] = $temp;
+				++$count;
+			}
+			// Replace the statements that were rewritten, last first
+			foreach (array_reverse($extents, true) as $k => list($start, $end))
+				if ($statements[$k] != substr($code, $start, $end - $start))
+					$code = substr($code, 0, $start).$statements[$k].substr($code, $end);
+		}
+		// Declare the temporaries used in the function
+		if ($temps) {
+			sort($temps, SORT_NATURAL);
+			$code = substr($code, 0, $body + 1).' FLT '.implode(', ', $temps).';'.substr($code, $body + 1);
+		}
+	}
+	if ($debug) {
+		sort($reports);
+		foreach ($reports as list($line, $report))
+			file_put_contents('php://stderr', basename(__FILE__).': line '.$line.': '.$report.PHP_EOL, FILE_APPEND);
+	}
+	return $code;
+}
+
+// Returns the basic blocks from $start to $end as the start and end of each statement, a block being statements in a row at the
+// same level without braces, control statements, labels, jumps, or a statement that is controlled in between
+function find_basic_blocks($code, $start, $end) {
+	$blocks = array();
+	$statements = array();
+	$controlled = false;
+	for ($i = $start; ($i += strspn($code, " \t\r\n", $i)) < $end; ) {
+		// Line markers from the preprocessor are skipped
+		if ($code[$i] == '#') {
+			$i = (($k = strpos($code, "\n", $i)) === false || $k > $end)? $end: $k;
+			continue;
+		}
+		$boundary = true;
+		if ($code[$i] == '{' || $code[$i] == '}') {
+			++$i;
+			$controlled = false;
+		} else if (preg_match('/\G(?:(?:if|for|while|switch)\s*\(|(?:else|do)\b)/', $code, $matches, 0, $i)) {
+			$i += strlen($matches[0]);
+			if (substr($matches[0], -1) == '(') {
+				if (!($parsed = parse_call_arguments($code, $i)))
+					break;
+				$i = $parsed[0];
+			}
+			$controlled = true;
+		} else if (preg_match('/\G(?:case\b(?:[^:;\'"]|\'(?:[^\'\\\\]|\\\\.)*\')*|[A-Za-z_]\w*\s*):/', $code, $matches, 0, $i)) {
+			$i += strlen($matches[0]);
+			$controlled = false;
+		} else {
+			if (!($parsed = find_statement_end($code, $i)))
+				break;
+			if (!$controlled && !preg_match('/\G(?:return|goto|break|continue)\b/', $code, $matches, 0, $i)) {
+				$statements[] = array($i, $parsed[0]);
+				$boundary = false;
+			}
+			$i = $parsed[0];
+			$controlled = false;
+		}
+		if ($boundary && $statements) {
+			$blocks[] = $statements;
+			$statements = array();
+		}
+	}
+	if ($statements)
+		$blocks[] = $statements;
+	return $blocks;
+}
+
+// Lowers nested flt_add, flt_subtract, flt_multiply, and flt_divide calls in function bodies to straight-line flt_ext_* code
+// over FLT_EXT temporaries declared at the start of each function, so only the result of the whole expression is rounded
+function fuse_expressions($code) {
+	$output = '';
+	$depth = $next = 0;
+	$function = false;
+	for ($i = 0, $length = strlen($code); $i < $length; ) {
+		$c = $code[$i];
+		if ($c == '"' || $c == "'") {
+			$j = skip_literal($code, $i);
+			$output .= substr($code, $i, $j - $i);
+			$i = $j;
+			continue;
+		}
+		// Each full expression starts again from the first temporary
+		if (strpos(';{}', $c) !== false)
+			$next = 0;
+		if ($c == '{') {
+			// A function body starts after the parameters
+			for ($j = strlen($output) - 1; $j >= 0 && ctype_space($output[$j]); --$j);
+			if (!$depth++ && ($function = ($j >= 0 && $output[$j] == ')'))) {
+				$body = strlen($output) + 1;
+				$temps = 0;
+			}
+		} else if ($c == '}') {
+			// Declare the temporaries used in the function
+			if (!--$depth && $function && $temps) {
+				$output .= $c;
+				$output = substr($output, 0, $body).' FLT_EXT flt_ext_'.implode(', flt_ext_', range(0, $temps - 1)).';'.substr($output, $body);
+				++$i;
+				continue;
+			}
+		} else if ($depth && $function && ($fused = fuse_call($code, $i, $next, $temps))) {
+			list($i, $expression) = $fused;
+			$output .= $expression;
+			continue;
+		}
+		$output .= $c;
+		++$i;
+	}
+	return $output;
+}
+
+// Returns the end of the string or character constant starting at $i
+function skip_literal($code, $i) {
+	$quote = $code[$i];
+	for (++$i, $length = strlen($code); $i < $length && $code[$i] != $quote; ++$i)
+		if ($code[$i] == '\\')
+			++$i;
+	return $i + 1;
+}
+
+// Fuses the call at $i if it has at least two nested operations, using temporaries from $base, returns the end of the call and the
+// replacement, or null if not fused. $base is moved past the temporaries used, so that fused calls in the same expression don't
+// share any, as C doesn't sequence the arguments of a call.
+function fuse_call($code, $i, &$base, &$temps) {
+	if ($code[$i] != 'f' || ($i && preg_match('/\w/', $code[$i - 1])) || !($parsed = parse_fusable_call($code, $i)))
+		return null;
+	list($end, $tree) = $parsed;
+	if (count_fusable_operations($tree) < 2)
+		return null;
+	$steps = array();
+	$used = $base;
+	emit_fused($tree, $base, $steps, $used);
+	$temps = max($temps, $used);
+	$expression = '('.implode(', ', $steps).', flt_ext_store(&flt_ext_'.$base.'))';
+	$base = $used;
+	return array($end, $expression);
+}
+
+// Parses a flt_add, flt_subtract, flt_multiply, or flt_divide call at $i into array(operation, left, right) where nested calls
+// are parsed the same way and anything else is kept as a string, returns the end of the call and the tree, or null if not a call
+function parse_fusable_call($code, $i) {
+	if (!preg_match('/\Gflt_(add|subtract|multiply|divide)\s*\(/', $code, $matches, 0, $i)
+		|| !($parsed = parse_call_arguments($code, $i + strlen($matches[0]))) || count($parsed[1]) != 2)
+		return null;
+	list($end, $arguments) = $parsed;
+	foreach ($arguments as &$argument)
+		if (($parsed = parse_fusable_call($argument, 0)) && $parsed[0] == strlen($argument))
+			$argument = $parsed[1];
+	return array($end, array($matches[1], $arguments[0], $arguments[1]));
+}
+
+// Splits the arguments of a call starting at $i, just after the opening bracket, returns the end of the call and the
+// arguments, or null if the closing bracket is missing
+function parse_call_arguments($code, $i) {
+	$arguments = array();
+	$length = strlen($code);
+	for ($j = $start = $i, $level = 0; $j < $length && ($j += strcspn($code, '"\'()[]{},', $j)) < $length; ++$j) {
+		$c = $code[$j];
+		if ($c == '"' || $c == "'")
+			$j = skip_literal($code, $j) - 1;
+		else if (strpos('([{', $c) !== false)
+			++$level;
+		else if (strpos(')]}', $c) !== false) {
+			if (!$level--)
+				break;
+		} else if ($c == ',' && !$level) {
+			$arguments[] = trim(substr($code, $start, $j - $start));
+			$start = $j + 1;
+		}
+	}
+	if ($j >= $length)
+		return null;
+	$arguments[] = trim(substr($code, $start, $j - $start));
+	return array($j + 1, $arguments);
+}
+
+function count_fusable_operations($tree) {
+	return is_array($tree)? 1 + count_fusable_operations($tree[1]) + count_fusable_operations($tree[2]): 0;
+}
+
+// Evaluates the tree into temporary $t, higher temporaries are used for right operands and for any expressions fused in operands
+function emit_fused($tree, $t, &$steps, &$temps) {
+	$temps = max($temps, $t + 1);
+	list($operation, $left, $right) = $tree;
+	if (is_array($left))
+		emit_fused($left, $t, $steps, $temps);
+	else
+		$steps[] = 'flt_ext_load(&flt_ext_'.$t.', '.fuse_operand($left, $t + 1, $temps).')';
+	if (is_array($right)) {
+		emit_fused($right, $t + 1, $steps, $temps);
+		$steps[] = 'flt_ext_'.$operation.'(&flt_ext_'.$t.', &flt_ext_'.($t + 1).')';
+	} else
+		$steps[] = 'flt_ext_'.$operation.'_f(&flt_ext_'.$t.', '.fuse_operand($right, $t + 1, $temps).')';
+}
+
+// Fuses any expressions within an operand, e.g. in the arguments of flt_sqrt
+function fuse_operand($operand, $base, &$temps) {
+	$output = '';
+	$next = $base;
+	for ($i = 0, $length = strlen($operand); $i < $length; ) {
+		$c = $operand[$i];
+		if ($c == '"' || $c == "'") {
+			$j = skip_literal($operand, $i);
+			$output .= substr($operand, $i, $j - $i);
+			$i = $j;
+		} else if ($fused = fuse_call($operand, $i, $next, $temps)) {
+			list($i, $expression) = $fused;
+			$output .= $expression;
+		} else {
+			$output .= $c;
+			++$i;
+		}
+	}
+	return $output;
+}
+
+// Same as floatval, but also handles C99 hexadecimal literals, e.g. 0x1.8p+3
+function literal_floatval($literal) {
+	if (preg_match('/^([-+]?)0[Xx]([0-9A-Fa-f]*)\.?([0-9A-Fa-f]*)[Pp]([-+]?[0-9]+)/', $literal, $matches))
+		return (($matches[1] == '-')? -1: 1) * hexdec('0'.$matches[2].$matches[3]) * pow(2, intval($matches[4]) - 4 * strlen($matches[3]));
+	return floatval($literal);
+}
+
 function get_token_extent($location) {
 	$line = 0;
 	$min = +getrandmax();
@@ -472,29 +1469,57 @@ function get_next_token($input, $fn = 'flt_') {
 	return $token;
 }
 
-function check_for_signed_or_unsigned($message, $signed, $unsigned) {
-	return (is_numeric(strpos($message->message, 'unsigned'))
-		|| preg_match('/uint[0-9]+_t/', $message->message))? $unsigned: $signed;
+// Returns the conversion to or from FLT for the integer type in the message or its notes, the 16 and 8 bit forms for narrow
+// types, flt_itof and the like for int, which use the 16 bit forms where int is 16 bits, or the 32 bit forms otherwise
+function get_integer_conversion($message, $to_flt) {
+	$conversions = array(
+		'unsigned char' => array('flt_uctof', 'flt_ftouc'),		'uint8_t' => array('flt_uctof', 'flt_ftouc'),
+		'signed char' => array('flt_itof16', 'flt_ftoi16'),		'int8_t' => array('flt_itof16', 'flt_ftoi16'),
+		'char' => array('flt_itof16', 'flt_ftoi16'),
+		'short int' => array('flt_itof16', 'flt_ftoi16'),		'int16_t' => array('flt_itof16', 'flt_ftoi16'),
+		'short unsigned int' => array('flt_uitof16', 'flt_ftoui16'),	'uint16_t' => array('flt_uitof16', 'flt_ftoui16'),
+		'int' => array('flt_itof', 'flt_ftoi'),
+		'unsigned int' => array('flt_uitof', 'flt_ftoui')
+	);
+	$text = $message->message;
+	if (isset($message->children))
+		foreach ($message->children as $child)
+			$text .= PHP_EOL.$child->message;
+	// The first integer type, using the underlying type of a typedef
+	$type = '';
+	preg_match_all('/‘([^’]+)’(?: \{aka ‘([^’]+)’\})?/', $text, $matches, PREG_SET_ORDER);
+	foreach ($matches as $match) {
+		$candidate = isset($match[2])? $match[2]: $match[1];
+		if (preg_match('/^'.INT_TYPE_REGEX.'$/', $candidate)) {
+			$type = $candidate;
+			break;
+		}
+	}
+	if (isset($conversions[$type]))
+		return $conversions[$type][$to_flt? 0: 1];
+	$unsigned = is_numeric(strpos($type, 'unsigned')) || preg_match('/uint[0-9]+_t|size_t/', $type);
+	return $to_flt? ($unsigned? 'flt_ultof': 'flt_ltof'): ($unsigned? 'flt_ftoul': 'flt_ftol');
+}
+
+// Merged lines are recorded in $modified as the line merged onto, the column the text starts at, and how much leading whitespace was trimmed
+function merge_lines(&$lines, &$modified, $i, $j) {
+	if (!isset($modified[$i]))
+		$modified[$i] = true;
+	$modified[$j] = array($i, strlen($lines[$i]) + 1, strlen($lines[$j]) - strlen(ltrim($lines[$j])));
+	$lines[$i] .= ' '.trim($lines[$j]);
+	$lines[$j] = '';
 }
 
 function merge_next_line(&$lines, &$modified, $i) {
 	$j = $i + 1;
-	if ($j < count($lines)) {
-		$lines[$i] .= ' '.trim($lines[$j]);
-		$modified[] = $i;
-		$lines[$j] = '';
-		$modified[] = $j;
-	}
+	if ($j < count($lines))
+		merge_lines($lines, $modified, $i, $j);
 }
 
 function merge_previous_line(&$lines, &$modified, $i) {
 	$j = $i - 1;
-	if ($j >= 0) {
-		$lines[$j] .= ' '.trim($lines[$i]);
-		$modified[] = $j;
-		$lines[$i] = '';
-		$modified[] = $i;
-	}
+	if ($j >= 0)
+		merge_lines($lines, $modified, $j, $i);
 }
 
 function join_multiline_messages(&$lines, $messages, &$modified) {
@@ -511,33 +1536,41 @@ function join_multiline_messages(&$lines, $messages, &$modified) {
 				}
 			}
 		}
-		// Multiline?
+		// Multiline? Lines already merged by an earlier message are followed to where they went.
 		if ($min < $max) {
-			$modified[] = $min;
-			for ($l = $min + 1; $l <= $max; ++$l) {
-				$lines[$min] .= ' '.trim($lines[$l]);
-				$lines[$l] = '';
-				$modified[] = $l;
-			}
+			for ($i = $min; isset($modified[$i]) && is_array($modified[$i]); $i = $modified[$i][0]);
+			for ($l = $min + 1; $l <= $max; ++$l)
+				if (!isset($modified[$l]) || !is_array($modified[$l]))
+					merge_lines($lines, $modified, $i, $l);
 		}
 	}
 }
 
-// To use in process_initializer
-function flt_atof($a) { return floatval($a); }
-function flt_ltof($a) { return floatval($a); }
-function flt_ultof($a) { return floatval($a); }
+// To use in process_initializer and fold_constants, each result is rounded to nearest IEEE 754 binary32, and as the
+// operands are binary32, rounding the double result again doesn't change it. FLT itself doesn't always round correctly,
+// or handle underflow the same way, so the literal may differ slightly from what FLT would compute at run time.
+function flt_atof($a) { return flt_round_binary32(literal_floatval($a)); }
+function flt_ltof($a) { return flt_round_binary32(floatval($a)); }
+function flt_ultof($a) { return flt_round_binary32(floatval($a)); }
+function flt_itof($a) { return flt_round_binary32(floatval($a)); }
+function flt_uitof($a) { return flt_round_binary32(floatval($a)); }
+function flt_itof16($a) { return floatval($a); }
+function flt_uitof16($a) { return floatval($a); }
+function flt_uctof($a) { return floatval($a); }
 
-function flt_add($a, $b) { return $a + $b; }
-function flt_subtract($a, $b) { return $a - $b; }
-function flt_multiply($a, $b) { return $a * $b ; }
-function flt_divide($a, $b) { return $a / $b; }
+function flt_add($a, $b) { return flt_round_binary32($a + $b); }
+function flt_subtract($a, $b) { return flt_round_binary32($a - $b); }
+function flt_multiply($a, $b) { return flt_round_binary32($a * $b); }
+function flt_divide($a, $b) { return flt_round_binary32($a / $b); }
 function flt_negated($a) { return -$a; }
+function flt_fabs($a) { return abs($a); }
+
+function flt_round_binary32($a) { return unpack('G', pack('G', $a))[1]; }
 
 function process_initializer(&$lines, $message, &$modified) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$p = substr($line, $start);
 			// Evaluate the initializer if possible
@@ -545,7 +1578,7 @@ function process_initializer(&$lines, $message, &$modified) {
 				try {
 					if (is_numeric($result = eval('return '.$token.';'))) {
 						$lines[$l] = str_replace($token, '0x'.strtoupper(bin2hex(pack('G', $result))).' /* '.sprintf('%g', $result).' */', $line);
-						$modified[] = $l;
+						$modified[$l] = true;
 					}
 				} catch (Throwable $e) {
     					process_unhandled($message);
@@ -571,28 +1604,28 @@ function process_arithmetic_binary_operands(&$lines, $message, &$modified) {
 			list($p, $p_start, $p_finish) = get_token_extent($message->locations[1]);
 		case 1:
 			list($o, $o_start, $o_finish) = get_token_extent($message->locations[0]);
-			if (!in_array($o, $modified)) {
+			if (!isset($modified[$o])) {
 				$op = substr($lines[$o], $o_start, $o_finish - $o_start + 1);
 				$fn = $operators[$op];
 			}
 	}
 	// O is the operator, P is the left operand, Q is the right operand
 	if ($o >= 0 && $p >= 0 && $q >= 0) {
-		if (!in_array($o, $modified) && !in_array($p, $modified) && !in_array($q, $modified)) {
+		if (!isset($modified[$o]) && !isset($modified[$p]) && !isset($modified[$q])) {
 			// Work in reverse right (Q) - operator (O) - left (P), so that the indices are still valid
 			$line = $lines[$q];
 			$lines[$q] = substr($line, 0, $q_finish + 1).')'.substr($line, $q_finish + 1);
-			$modified[] = $q;
+			$modified[$q] = true;
 			$line = $lines[$o];
 			$lines[$o] = substr($line, 0, $o_start).','.substr($line, $o_finish + 1);
-			$modified[] = $o;
+			$modified[$o] = true;
 			$line = $lines[$p];
 			$lines[$p] = substr($line, 0, $p_start).$fn.'('.(strlen($op) == 2? '&': '').substr($line, $p_start);
-			$modified[] = $p;
+			$modified[$p] = true;
 		}
 	// O is the operator, P is the left or right operand
 	} else if ($o >= 0 && $p >= 0) {
-		if (!in_array($o, $modified) && !in_array($p, $modified)) {
+		if (!isset($modified[$o]) && !isset($modified[$p])) {
 			// Have the right operand, need the left, expected to be simple
 			if ($p > $o || $p_start > $o_start) {
 				$left = get_previous_token(substr($lines[$o], 0, $o_start));
@@ -600,11 +1633,11 @@ function process_arithmetic_binary_operands(&$lines, $message, &$modified) {
 					// Work in reverse right (P) - operator (O) - left, so that the indices are still valid
 					$line = $lines[$p];
 					$lines[$p] = substr($line, 0, $p_finish + 1).')'.substr($line, $p_finish + 1);
-					$modified[] = $p;
+					$modified[$p] = true;
 					$line = $lines[$o];
 					$working = split_previous_token($left, substr($line, 0, $o_start));
 					$lines[$o] = $working[0].$fn.'('.(strlen($op) == 2? '&': '').$left.$working[1].','.substr($line, $o_finish + 1);
-					$modified[] = $o;
+					$modified[$o] = true;
 				} else
 					// Can't find the left operand, might be on the previous line
 					merge_previous_line($lines, $modified, $o);
@@ -616,10 +1649,10 @@ function process_arithmetic_binary_operands(&$lines, $message, &$modified) {
 					$line = $lines[$o];
 					$working = explode($right, substr($line, $o_finish + 1), 2);
 					$lines[$o] = substr($line, 0, $o_start).','.$working[0].$right.')'.$working[1];
-					$modified[] = $o;
+					$modified[$o] = true;
 					$line = $lines[$p];
 					$lines[$p] = substr($line, 0, $p_start).$fn.'('.(strlen($op) == 2? '&': '').substr($line, $p_start);
-					$modified[] = $p;
+					$modified[$p] = true;
 				} else
 					// Can't find the right operand, might be on the next line
 					merge_next_line($lines, $modified, $o);
@@ -628,7 +1661,7 @@ function process_arithmetic_binary_operands(&$lines, $message, &$modified) {
 		}
 	// O is the operator, both operands are expected to be simple
 	} else if ($o >= 0) {
-		if (!in_array($o, $modified)) {
+		if (!isset($modified[$o])) {
 			$line = $lines[$o];
 			$p1 = substr($line, 0, $o_start);
 			$left = get_previous_token($p1);
@@ -640,7 +1673,7 @@ function process_arithmetic_binary_operands(&$lines, $message, &$modified) {
 					$working = explode($right, $p2, 2);
 					$p2 = $working[0].$right.')'.$working[1];
 					$lines[$o] = $p1.$p2;
-					$modified[] = $o;
+					$modified[$o] = true;
 			} else {
 				// Can't find all the operands, might be on the next or the previous line
 				if ($right == '')
@@ -670,28 +1703,28 @@ function process_comparison_binary_operands(&$lines, $message, &$modified) {
 			list($p, $p_start, $p_finish) = get_token_extent($message->locations[1]);
 		case 1:
 			list($o, $o_start, $o_finish) = get_token_extent($message->locations[0]);
-			if (!in_array($o, $modified)) {
+			if (!isset($modified[$o])) {
 				$op = substr($lines[$o], $o_start, $o_finish - $o_start + 1);
 				$cmp = $comparisons[$op];
 			}
 	}
 	// O is the operator, P is the left operand, Q is the right operand
 	if ($o >= 0 && $p >= 0 && $q >= 0) {
-		if (!in_array($o, $modified) && !in_array($p, $modified) && !in_array($q, $modified)) {
+		if (!isset($modified[$o]) && !isset($modified[$p]) && !isset($modified[$q])) {
 			// Work in reverse right (Q) - operator (O) - left (P), so that the indices are still valid
 			$line = $lines[$q];
 			$lines[$q] = substr($line, 0, $q_finish + 1).','.$cmp.')'.substr($line, $q_finish + 1);
-			$modified[] = $q;
+			$modified[$q] = true;
 			$line = $lines[$o];
 			$lines[$o] = substr($line, 0, $o_start).','.substr($line, $o_finish + 1);
-			$modified[] = $o;
+			$modified[$o] = true;
 			$line = $lines[$p];
 			$lines[$p] = substr($line, 0, $p_start).'flt_compare('.substr($line, $p_start);
-			$modified[] = $p;
+			$modified[$p] = true;
 		}
 	// O is the operator, P is the left or right operand
 	} else if ($o >= 0 && $p >= 0) {
-		if (!in_array($o, $modified) && !in_array($p, $modified)) {
+		if (!isset($modified[$o]) && !isset($modified[$p])) {
 			// Have the right operand, need the left, expected to be simple
 			if ($p > $o || $p_start > $o_start) {
 				$left = get_previous_token(substr($lines[$o], 0, $o_start));
@@ -699,11 +1732,11 @@ function process_comparison_binary_operands(&$lines, $message, &$modified) {
 					// Work in reverse right (P) - operator (O) - left, so that the indices are still valid
 					$line = $lines[$p];
 					$lines[$p] = substr($line, 0, $p_finish + 1).','.$cmp.')'.substr($line, $p_finish + 1);
-					$modified[] = $p;
+					$modified[$p] = true;
 					$line = $lines[$o];
 					$working = split_previous_token($left, substr($line, 0, $o_start));
 					$lines[$o] = $working[0].'flt_compare('.$left.$working[1].','.substr($line, $o_finish + 1);
-					$modified[] = $o;
+					$modified[$o] = true;
 				} else
 					// Can't find the left operand, might be on the previous line
 					merge_previous_line($lines, $modified, $o);
@@ -715,10 +1748,10 @@ function process_comparison_binary_operands(&$lines, $message, &$modified) {
 					$line = $lines[$o];
 					$working = explode($right, substr($line, $o_finish + 1), 2);
 					$lines[$o] = substr($line, 0, $o_start).','.$working[0].$right.','.$cmp.')'.$working[1];
-					$modified[] = $o;
+					$modified[$o] = true;
 					$line = $lines[$p];
 					$lines[$p] = substr($line, 0, $p_start).'flt_compare('.substr($line, $p_start);
-					$modified[] = $p;
+					$modified[$p] = true;
 				} else
 					// Can't find the right operand, might be on the next line
 					merge_next_line($lines, $modified, $o);
@@ -727,7 +1760,7 @@ function process_comparison_binary_operands(&$lines, $message, &$modified) {
 		}
 	// O is the operator, both operands are expected to be simple
 	} else if ($o >= 0) {
-		if (!in_array($o, $modified)) {
+		if (!isset($modified[$o])) {
 			$line = $lines[$o];
 			$p1 = substr($line, 0, $o_start);
 			$left = get_previous_token($p1);
@@ -739,7 +1772,7 @@ function process_comparison_binary_operands(&$lines, $message, &$modified) {
 					$working = explode($right, $p2, 2);
 					$p2 = $working[0].$right.','.$cmp.')'.$working[1];
 					$lines[$o] = $p1.$p2;
-					$modified[] = $o;
+					$modified[$o] = true;
 			} else {
 				// Can't find all the operands, might be on the next or the previous line
 				if ($right == '')
@@ -755,7 +1788,7 @@ function process_comparison_binary_operands(&$lines, $message, &$modified) {
 function process_unary_minus(&$lines, $message, &$modified) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$p1 = substr($line, 0, $start);
 			$p2 = substr($line, $finish + 1);
@@ -764,13 +1797,13 @@ function process_unary_minus(&$lines, $message, &$modified) {
 				$working = explode('flt_atof("', $p2, 2);
 				$p2 = $working[0].'flt_atof("-'.$working[1];
 				$lines[$l] = $p1.$p2;
-				$modified[] = $l;
+				$modified[$l] = true;
 			// Update an expression
 			} else if (($token = get_next_token($p2)) != '') {
 				$working = explode($token, $p2, 2);
 				$p2 = $working[0].'flt_negated('.$token.')'.$working[1];
 				$lines[$l] = $p1.$p2;
-				$modified[] = $l;
+				$modified[$l] = true;
 			} else
 				// Can find anything? Might be on the next line.
 				merge_next_line($lines, $modified, $l);
@@ -783,10 +1816,10 @@ function process_unary_plus(&$lines, $message, &$modified) {
 	if (count($message->locations) == 1) {
 		// Just get rid of the plus sign!
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$lines[$l] = substr($line, 0, $start).substr($line, $finish + 1);
-			$modified[] = $l;
+			$modified[$l] = true;
 		}
 	} else
 		process_unhandled($message);
@@ -795,7 +1828,7 @@ function process_unary_plus(&$lines, $message, &$modified) {
 function process_unary_exclamation_mark(&$lines, $message, &$modified) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$p1 = substr($line, 0, $start);
 			$p2 = substr($line, $finish + 1);
@@ -804,7 +1837,7 @@ function process_unary_exclamation_mark(&$lines, $message, &$modified) {
 				$working = explode($token, $p2, 2);
 				$p2 = $working[0].'flt_iszero('.$token.')'.$working[1];
 				$lines[$l] = $p1.$p2;
-				$modified[] = $l;
+				$modified[$l] = true;
 			} else
 				// Can find anything? Might be on the next line.
 				merge_next_line($lines, $modified, $l);
@@ -816,7 +1849,7 @@ function process_unary_exclamation_mark(&$lines, $message, &$modified) {
 function process_increment_or_decrement(&$lines, $message, &$modified, $op) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$p1 = substr($line, 0, $start);
 			$p2 = substr($line, $finish + 1);
@@ -824,12 +1857,12 @@ function process_increment_or_decrement(&$lines, $message, &$modified, $op) {
 				$working = split_previous_token($token, $p1);
 				$p1 = $working[0].'flt_post_'.$op.'(&'.$token.')'.$working[1];
 				$lines[$l] = $p1.$p2;
-				$modified[] = $l;
+				$modified[$l] = true;
 			} else if (($token = get_next_token($p2)) != '') {
 				$working = explode($token, $p2, 2);
 				$p2 = $working[0].'flt_pre_'.$op.'(&'.$token.')'.$working[1];
 				$lines[$l] = $p1.$p2;
-				$modified[] = $l;
+				$modified[$l] = true;
 			} else
 			// Didn't find anything? Likely across multiple lines, gcc doesn't give enough info to address this case
 				process_unhandled($message);
@@ -842,12 +1875,12 @@ function process_cast(&$lines, $message, &$modified, $regex) {
 	foreach ($message->locations as $location) {
 		// Remove the cast!
 		list($l, $start, $finish) = get_token_extent($location);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$count = 0;
 			$lines[$l] = preg_replace('/\(\s*'.$regex.'\s*\)/', '', $line, 1, $count);
 			if ($count)
-				$modified[] = $l;
+				$modified[$l] = true;
 			// Didn't find anything? Likely a cast across multiple lines, gcc doesn't give enough info to address this case
 			else
 				process_unhandled($message);
@@ -858,34 +1891,107 @@ function process_cast(&$lines, $message, &$modified, $regex) {
 function process_incompatible_type(&$lines, $message, &$modified, $fn) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified))
+		if (!isset($modified[$l]))
 			process_complex_operand($lines, $modified, $l, $start, $finish, $fn);
 	} else
 		process_unhandled($message);
 }
 
-function process_printf_argument(&$lines, $message, &$modified) {
+function process_printf_argument(&$lines, $message, &$modified, $stack_buffers) {
 	if (count($message->locations) == 2) {
 		list($l, $f_start, $f_finish) = get_token_extent($message->locations[0]);
 		list($l, $s_start, $s_finish) = get_token_extent($message->locations[1]);
-		if (!in_array($l, $modified)) {
-			// Set up the formats, precision to no more than nine places
+		if (!isset($modified[$l])) {
+			// Set up the format for the string, and the packed specification for the FLT
 			list($left, $padding, $width, $signed, $precision, $specifier)
 				= array_values(parse_format(substr($lines[$l], $f_start, $f_finish - $f_start + 1)));
+			// A precision given as an argument would be left over in the argument list
+			if (strpos($precision, '*') !== false) {
+				process_unhandled($message);
+				return;
+			}
 			$fmt1 = '%'.$left.$padding.$width.'s';
-			$fmt2 = '%'.$signed.((strlen($precision) > 2)? '.9': $precision).$specifier;
+			$spec = get_format_spec($signed, $precision, $specifier);
 			$line = $lines[$l];
 			$src = substr($line, $s_start, $s_finish - $s_start + 1);
 			$p1 = substr($line, 0, $f_start);
 			$p2 = substr($line, $f_finish + 1, $s_start - $f_finish - 1);
 			$p3 = substr($line, $s_finish + 1);
-			$lines[$l] = $p1.$fmt1.$p2.'flt_ftoa('.$src.',"'.$fmt2.'")'.$p3;
-			$modified[] = $l;
+			// Use a buffer on the stack if the *printf call is a statement on its own, otherwise use the ring buffers in flt_ftoa_fmt
+			if ($stack_buffers && ($statement = get_printf_statement($line, $f_start))) {
+				list($fn, $call) = $statement;
+				// Need a unique name for each parameter, and enough space for "E" (17) or "F" (51) format
+				$bfr = 'flt_bfr_'.(substr_count($call, 'flt_ftoa_fmt_r(') + 1);
+				$len = (stripos($specifier, 'e') !== false)? 17: 51;
+				$line = $p1.$fmt1.$p2.'(flt_ftoa_fmt_r('.$src.','.$spec.','.$bfr.','.$len.'),'.$bfr.')'.$p3;
+				// Enclose the statement in a block declaring the buffer
+				$call = get_next_token(substr($line, $fn), 'printf');
+				preg_match('/^\s*;/', substr($line, $fn + strlen($call)), $matches);
+				$end = $fn + strlen($call) + strlen($matches[0]);
+				$lines[$l] = substr($line, 0, $fn).'{char '.$bfr.'['.$len.'];'.substr($line, $fn, $end - $fn).'}'.substr($line, $end);
+			} else
+				$lines[$l] = $p1.$fmt1.$p2.'flt_ftoa_fmt('.$src.','.$spec.')'.$p3;
+			$modified[$l] = true;
 		}
 	} else
 		process_unhandled($message);
 }
 
+// Returns the packed specification for flt_ftoa_fmt*, so no format string is parsed at run time. Precision to no more
+// than nine places, and defaults to six if not given as digits, like flt_spec in flt-io.c. Written as a number since the
+// FLT_FMT_* macros are gone after preprocessing.
+function get_format_spec($signed, $precision, $specifier) {
+	if (stripos($specifier, 'a') !== false)
+		$spec = get_format_constant('FLT_FMT_A');
+	elseif (stripos($specifier, 'e') !== false)
+		$spec = get_format_constant('FLT_FMT_E');
+	elseif (stripos($specifier, 'f') !== false)
+		$spec = get_format_constant('FLT_FMT_F');
+	else
+		$spec = get_format_constant('FLT_FMT_G');
+	if (preg_match('/[AEFG]/', $specifier))
+		$spec |= get_format_constant('FLT_FMT_UPPER');
+	if (strlen($signed))
+		$spec |= get_format_constant('FLT_FMT_PLUS');
+	$spec |= preg_match('/^\.(\d*)$/', $precision, $matches)? min((int)$matches[1], 9): 6;
+	return sprintf('0x%04X', $spec);
+}
+
+// Returns the value of an FLT_FMT_* constant, as defined in flt.h so the two can't differ
+function get_format_constant($name) {
+	static $constants = null;
+	if ($constants === null) {
+		$constants = array();
+		preg_match_all('/^#\s*define\s+(FLT_FMT_\w+)\s+\(?(0x[0-9A-Fa-f]+)\)?/m', file_get_contents(get_header('flt.h')), $matches, PREG_SET_ORDER);
+		foreach ($matches as list(, $key, $value))
+			$constants[$key] = hexdec($value);
+	}
+	if (!array_key_exists($name, $constants)) {
+		file_put_contents('php://stderr', 'Error: "'.$name.'" not found in flt.h!'.PHP_EOL, FILE_APPEND);
+		exit(1);
+	}
+	return $constants[$name];
+}
+
+// Returns the offset and the text of the *printf call if it makes up a whole statement on the line, otherwise false
+function get_printf_statement($line, $offset) {
+	// Find the start of the *printf call before the offset, it has to be at the start of a statement
+	if (!preg_match_all('/\b[a-z]*printf\s*\(/', substr($line, 0, $offset), $matches, PREG_OFFSET_CAPTURE))
+		return false;
+	$fn = end($matches[0])[1];
+	// The call has to start a statement: at the start of the line, after ;, {, }, or else, or after a label. A label is a
+	// case up to its colon, skipping any character constant such as ':', or default or a goto label, so the colon of a ?:
+	// expression doesn't count.
+	$label = '(?:case\b(?:[^:;\'"]|\'(?:[^\'\\\\]|\\\\.)*\')*|[A-Za-z_]\w*\s*):';
+	if (!preg_match('/(?:^|[;{}]|\belse|(?:^|[;{}:])\s*'.$label.')\s*$/', substr($line, 0, $fn)))
+		return false;
+	// The call has to end on this line and be followed by a semicolon
+	$call = get_next_token(substr($line, $fn), 'printf');
+	if (!strlen($call) || !preg_match('/^\s*;/', substr($line, $fn + strlen($call))))
+		return false;
+	return array($fn, $call);
+}
+
 function process_scanf_argument(&$lines, $message, &$modified) {
 	// Will need these
 	$scn = 'scanf';
@@ -894,12 +2000,17 @@ function process_scanf_argument(&$lines, $message, &$modified) {
 	if (count($message->locations) == 2) {
 		list($l, $f_start, $f_finish) = get_token_extent($message->locations[0]);
 		list($l, $d_start, $d_finish) = get_token_extent($message->locations[1]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			// Check if scanf is on the same line
 			if (is_numeric($scanf = strrpos(substr($line, 0, $f_start), $scn))) {
+				// A sscanf with only FLT parameters is converted all at once to flt_parse_array
+				if ($sscanf = get_sscanf_array($line, $scanf)) {
+					list($start, $call, $replacement) = $sscanf;
+					$lines[$l] = substr($line, 0, $start).$replacement.substr($line, $start + strlen($call));
+					$modified[$l] = true;
 				// Check for the end of the expression
-				if ($expression = get_next_token(substr($line, $scanf), $scn)) {
+				} else if ($expression = get_next_token(substr($line, $scanf), $scn)) {
 					// Set up the format, max and default of 50 characters
 					$parsed = parse_format(substr($lines[$l], $f_start, $f_finish - $f_start + 1));
 					$width = $parsed['wdt'];
@@ -920,7 +2031,7 @@ function process_scanf_argument(&$lines, $message, &$modified) {
 					$expression .= get_next_token(substr($line, $scanf), $scn);
 					$working = explode($expression, $line, 2);
 					$lines[$l] = $working[0].($count == 1? $lsr.'=': '').$expression.','.$dst.'=flt_atof('.$gsb.'('.$count.'))'.($count == 1? ','.$lsr: '').$working[1];
-					$modified[] = $l;
+					$modified[$l] = true;
 				} else
 					// Couldn't find end of scanf call, might be on the next line
 					merge_next_line($lines, $modified, $l);
@@ -932,6 +2043,65 @@ function process_scanf_argument(&$lines, $message, &$modified) {
 		process_unhandled($message);
 }
 
+// Returns the offset, the text, and the flt_parse_array replacement of a sscanf call on the line if all its parameters
+// are FLT without widths, otherwise false
+function get_sscanf_array($line, $scanf) {
+	// Will need these
+	$vls = 'g_flt_scanf_values';
+	$lsr = 'g_flt_last_scanf_result';
+	// Has to be sscanf, and the call has to end on this line
+	$start = $scanf - 1;
+	if ($start < 0 || $line[$start] != 's' || ($start && preg_match('/\w/', $line[$start - 1])))
+		return false;
+	$call = get_next_token(substr($line, $start), 'sscanf');
+	if (!preg_match('/^sscanf\s*\((.*)\)$/s', $call, $matches))
+		return false;
+	// The format has to be a literal with only FLT conversions, separated by nothing but whitespace like flt_parse_array
+	$arguments = split_arguments($matches[1]);
+	$count = count($arguments) - 2;
+	if ($count < 1 || $count > FLT_SCANF_VALUES
+		|| !preg_match('/^"(?:(?:\s|\\\\[fnrtv])*%l?[AaEeFfGg])+(?:\s|\\\\[fnrtv])*"$/', $arguments[1])
+		|| substr_count($arguments[1], '%') != $count)
+		return false;
+	// Parse into the values, then copy to each destination
+	$replacement = '('.$lsr.'=flt_parse_array('.$arguments[0].','.$vls.','.$count.')';
+	for ($i = 0; $i < $count; ++$i) {
+		$dst = $arguments[$i + 2];
+		$dst = ($dst[0] == '&')? substr($dst, 1): '*('.$dst.')';
+		$replacement .= ','.$dst.'='.$vls.'['.$i.']';
+	}
+	$replacement .= ','.$lsr.')';
+	return array($start, $call, $replacement);
+}
+
+// Splits function arguments at the top level commas, skipping over anything in brackets or literals
+function split_arguments($input) {
+	$arguments = array();
+	$argument = $quote = '';
+	for ($i = 0, $level = 0, $limit = strlen($input); $i < $limit; ++$i) {
+		$char = $input[$i];
+		if ($quote) {
+			if ($char == '\\' && $i + 1 < $limit)
+				$char .= $input[++$i];
+			else if ($char == $quote)
+				$quote = '';
+		} else if ($char == '"' || $char == "'")
+			$quote = $char;
+		else if (strpos('([{', $char) !== false)
+			++$level;
+		else if (strpos(')]}', $char) !== false)
+			--$level;
+		else if ($char == ',' && !$level) {
+			$arguments[] = trim($argument);
+			$argument = '';
+			continue;
+		}
+		$argument .= $char;
+	}
+	$arguments[] = trim($argument);
+	return $arguments;
+}
+
 function parse_format($format) {
 	for ($i = 0, $j = strlen($format), $mode = 1; $i < $j; ++$i) {
 		switch ($char = $format[$i]) {
@@ -979,6 +2149,7 @@ function parse_format($format) {
 				$mode = 3;
 				$precision .= $char;
 				break;
+			case 'A': case 'a':
 			case 'E': case 'e':
 			case 'F': case 'f': 
 			case 'G': case 'g': 
@@ -994,7 +2165,7 @@ function parse_format($format) {
 function process_assignment(&$lines, $message, &$modified, $fn) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			$p1 = substr($line, 0, $start);
 			$p2 = substr($line, $start);
@@ -1003,7 +2174,7 @@ function process_assignment(&$lines, $message, &$modified, $fn) {
 				$working = explode($token, $p2, 2);
 				$p2 = $working[0].$fn.'('.$token.')'.$working[1];
 				$lines[$l] = $p1.$p2;
-				$modified[] = $l;
+				$modified[$l] = true;
 			} else
 				// Can find anything? Might be on the next line.
 				merge_next_line($lines, $modified, $l);
@@ -1024,11 +2195,11 @@ function process_first_operand(&$lines, $message, &$modified, $fn) {
 	}
 	// O is the operator, P is the left operand, Q is the right operand
 	if ($o >= 0 && $p >= 0 && $q >= 0) {
-		if (!in_array($p, $modified))
+		if (!isset($modified[$p]))
 			process_complex_operand($lines, $modified, $p, $p_start, $p_finish, $fn);
 	// O is the operator, P is the left or right operand
 	} else if ($o >= 0 && $p >= 0) {
-		if (!in_array($o, $modified) && !in_array($p, $modified)) {
+		if (!isset($modified[$o]) && !isset($modified[$p])) {
 			// Have the left operand
 			if ($p < $o || $p_start < $o_start)
 				process_complex_operand($lines, $modified, $p, $p_start, $p_finish, $fn);
@@ -1040,7 +2211,7 @@ function process_first_operand(&$lines, $message, &$modified, $fn) {
 		}
 	// O is the operator, left operand is expected to be simple
 	} else if ($o >= 0) {
-		if (!in_array($o, $modified))
+		if (!isset($modified[$o]))
 			process_simple_left_operand($lines, $modified, $o, $o_start, $fn);
 	} else
 		process_unhandled($message);
@@ -1058,11 +2229,11 @@ function process_second_operand(&$lines, $message, &$modified, $fn) {
 	}
 	// O is the operator, P is the left operand, Q is the right operand
 	if ($o >= 0 && $p >= 0 && $q >= 0) {
-		if (!in_array($q, $modified))
+		if (!isset($modified[$q]))
 			process_complex_operand($lines, $modified, $q, $q_start, $q_finish, $fn);
 	// O is the operator, P is the left or right operand
 	} else if ($o >= 0 && $p >= 0) {
-		if (!in_array($o, $modified) && !in_array($p, $modified)) {
+		if (!isset($modified[$o]) && !isset($modified[$p])) {
 			// Have the right operand
 			if ($p > $o || $p_start > $o_start)
 				process_complex_operand($lines, $modified, $p, $p_start, $p_finish, $fn);
@@ -1074,7 +2245,7 @@ function process_second_operand(&$lines, $message, &$modified, $fn) {
 		}
 	// O is the operator, right operand is expected to be simple
 	} else if ($o >= 0) {
-		if (!in_array($o, $modified))
+		if (!isset($modified[$o]))
 			process_simple_right_operand($lines, $modified, $o, $o_finish, $fn);
 	} else
 		process_unhandled($message);
@@ -1087,7 +2258,7 @@ function process_simple_left_operand(&$lines, &$modified, $o, $o_start, $fn) {
 	if ($left != '') {
 		$working = split_previous_token($left, $p1);
 		$lines[$o] = $working[0].(is_numeric($left)? 'flt_atof("'.$left.'")': $fn.'('.$left.')').$working[1].substr($line, $o_start);
-		$modified[] = $o;
+		$modified[$o] = true;
 	} else
 		// Can't find the left operand, might be on the previous line
 		merge_previous_line($lines, $modified, $o);
@@ -1100,7 +2271,7 @@ function process_simple_right_operand(&$lines, &$modified, $o, $o_finish, $fn) {
 	if ($right != '') {
 		$working = explode($right, $p1, 2);
 		$lines[$o] = substr($line, 0, $o_finish + 1).$working[0].(is_numeric($right)? 'flt_atof("'.$right.'")': $fn.'('.$right.')').$working[1];
-		$modified[] = $o;
+		$modified[$o] = true;
 	} else
 		// Can't find the right operand, might be on the next line
 		merge_next_line($lines, $modified, $o);
@@ -1109,24 +2280,24 @@ function process_simple_right_operand(&$lines, &$modified, $o, $o_finish, $fn) {
 function process_complex_operand(&$lines, &$modified, $l, $start, $finish, $fn) {
 	$line = $lines[$l];
 	$lines[$l] = substr($line, 0, $start).$fn.'('.substr($line, $start, $finish - $start + 1).')'.substr($line, $finish + 1);
-	$modified[] = $l;
+	$modified[$l] = true;
 }
 
 function process_non_gcc_extension(&$lines, &$substitutions, $message, &$modified) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			// Revise __fastcall__
 			if (str_contains($line, '__fastcall__')) {
 				$lines[$l] = str_replace('__fastcall__', '__attribute__ ((fastcall))', $line);
-				$modified[] = $l;
+				$modified[$l] = true;
 				// Undo in post-processing
 				$substitutions[] = array($lines[$l], $line);
 			// Change _Bool to __Bool
 			} else if (str_contains($line, '_Bool')) {
 				$lines[$l] = str_replace('_Bool', '__Bool', $line);
-				$modified[] = $l;
+				$modified[$l] = true;
 				// Undo in post-processing
 				$substitutions[] = array($lines[$l], $line);
 			} else
@@ -1140,11 +2311,11 @@ function process_non_gcc_extension(&$lines, &$substitutions, $message, &$modifie
 function process_conflicting_types(&$lines, &$substitutions, $message, &$modified) {
 	if (count($message->locations) == 1) {
 		list($l, $start, $finish) = get_token_extent($message->locations[0]);
-		if (!in_array($l, $modified)) {
+		if (!isset($modified[$l])) {
 			$line = $lines[$l];
 			if (str_contains($line, 'size_t') && str_contains($message->message, 'long unsigned int')) {
 				$lines[$l] = str_replace('size_t', 'long unsigned int', $line);
-				$modified[] = $l;
+				$modified[$l] = true;
 				// Undo in post-processing
 				$substitutions[] = array($lines[$l], $line);
 			} else {